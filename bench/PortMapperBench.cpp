@@ -0,0 +1,70 @@
+// SPDX-License-Identifier: Apache-2.0
+// Measure the cost of mapping port definitions to connections (makePortsRemover()) on a
+// generated design with a wide-port module instantiated many times, for growing port counts.
+// Time per connection should stay roughly constant, as connections of each instance are
+// resolved from an index built in a single visit of instance syntax.
+//
+// usage: port-mapper-bench [instances] [max ports]
+#include <slang/ast/Compilation.h>
+#include <slang/syntax/SyntaxTree.h>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include "../source/SetRemovers.hpp"
+
+static std::string generateDesign(int instances, int ports) {
+    std::string text = "module leaf(\n";
+    for (int i = 0; i < ports; i++) {
+        text += "  input logic p" + std::to_string(i) + (i + 1 < ports ? ",\n" : "\n");
+    }
+    text += ");\nendmodule\n\nmodule top;\n";
+    for (int i = 0; i < ports; i++) {
+        text += "  logic s" + std::to_string(i) + ";\n";
+    }
+    for (int n = 0; n < instances; n++) {
+        text += "  leaf u" + std::to_string(n) + "(\n";
+        for (int i = 0; i < ports; i++) {
+            // mix plain signals and expressions
+            std::string idx = std::to_string(i);
+            text += "    .p" + idx + (i % 2 ? "(s" + idx + ")" : "(s" + idx + " ^ 1'b1)");
+            text += i + 1 < ports ? ",\n" : "\n";
+        }
+        text += "  );\n";
+    }
+    text += "endmodule\n";
+    return text;
+}
+
+int main(int argc, char** argv) {
+    int instances = argc > 1 ? std::atoi(argv[1]) : 100;
+    int maxPorts = argc > 2 ? std::atoi(argv[2]) : 2048;
+
+    printf("ports\tinstances\tmapping\tper connection\n");
+    for (int ports = 128; ports <= maxPorts; ports *= 2) {
+        auto tree = SyntaxTree::fromText(generateDesign(instances, ports));
+        Compilation compilation;
+        compilation.addSyntaxTree(tree);
+        compilation.getAllDiagnostics();
+
+        auto start = std::chrono::steady_clock::now();
+        auto remover = makePortsRemover(compilation);
+        std::chrono::duration<double, std::milli> elapsed =
+            std::chrono::steady_clock::now() - start;
+
+        // each set is a port definition and its connection in one instance
+        size_t expectedSets = (size_t)instances * ports;
+        size_t connected = 0;
+        for (auto& set : remover.removals) {
+            connected += set.size() == 2 && set[1] != SourceRange::NoLocation;
+        }
+        if (remover.removals.size() != expectedSets || connected != expectedSets) {
+            fprintf(stderr, "expected %zu connections, got %zu of %zu removal sets\n",
+                    expectedSets, connected, remover.removals.size());
+            return 1;
+        }
+        printf("%d\t%d\t%.1fms\t%.3fus\n", ports, instances, elapsed.count(),
+               elapsed.count() * 1000 / expectedSets);
+    }
+    return 0;
+}
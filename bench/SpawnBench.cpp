@@ -0,0 +1,62 @@
+// SPDX-License-Identifier: Apache-2.0
+// Compare latency of launching a trivial check script with fork()+execv() (as sv-bugpoint
+// used to) and with spawnProcess(), depending on how much memory the parent holds.
+//
+// usage: spawn-bench [iterations]
+#include <sys/wait.h>
+#include <unistd.h>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include "../source/Spawn.hpp"
+
+static const char* checkScript = "/bin/true";
+
+static pid_t forkExec() {
+    pid_t pid = fork();
+    if (pid == 0) {
+        setpgid(0, 0);
+        char* argv[] = {const_cast<char*>(checkScript), nullptr};
+        execv(argv[0], argv);
+        _exit(127);
+    }
+    return pid;
+}
+
+static pid_t spawn() {
+    return spawnProcess({checkScript}, {"SV_BUGPOINT_WORKER=0"});
+}
+
+template <typename Launcher>
+static double measure(Launcher launch, int iterations) {
+    // Return mean launch+wait latency in microseconds
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++) {
+        pid_t pid = launch();
+        if (pid == -1 || waitpid(pid, nullptr, 0) != pid) {
+            perror("launch failed");
+            exit(1);
+        }
+    }
+    std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() / iterations;
+}
+
+int main(int argc, char** argv) {
+    int iterations = argc > 1 ? std::atoi(argv[1]) : 200;
+    printf("rss_mb\tfork_exec_us\tspawn_us\n");
+    for (size_t megabytes : {0, 64, 256, 1024, 2048}) {
+        // stands in for slang trees and compilations held by sv-bugpoint
+        size_t size = megabytes << 20;
+        std::unique_ptr<char[]> ballast(new char[size + 1]);
+        memset(ballast.get(), 1, size + 1);  // touch pages, so they get mapped
+
+        double forkExecUs = measure(forkExec, iterations);
+        double spawnUs = measure(spawn, iterations);
+        printf("%zu\t%.1f\t%.1f\n", megabytes, forkExecUs, spawnUs);
+    }
+    return 0;
+}
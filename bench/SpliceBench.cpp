@@ -0,0 +1,129 @@
+// SPDX-License-Identifier: Apache-2.0
+// Measure cost of writing IncrementalRewriter attempts to tmp file over a whole stage:
+// by printing the transformed tree (as sv-bugpoint used to), by splicing attempt's TextPatch
+// into the file holding printed base tree, and by splicing followed by comparing the result
+// with printed tree (what --verify-splices does on passing attempts).
+// Each spliced attempt is compared with printed tree, and the benchmark fails on mismatch.
+// Each attempt is treated as failed, so all of them transform the same tree.
+//
+// usage: splice-bench [input.sv] [batch size]
+#include <slang/syntax/SyntaxPrinter.h>
+#include <slang/syntax/SyntaxTree.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include "../source/IncrementalRewriter.hpp"
+
+namespace fs = std::filesystem;
+
+class ItemRemover : public IncrementalRewriter<ItemRemover> {
+    // subset of BodyRemover and DeclRemover, as bodyRemover attempts are the most numerous
+    // ones that get spliced
+   public:
+    ShouldVisitChildren handle(const ModuleDeclarationSyntax& node, bool isNodeRemovable) {
+        removeChildList(node, node.members);
+        return VISIT_CHILDREN;
+    }
+
+    ShouldVisitChildren handle(const FunctionDeclarationSyntax& node, bool isNodeRemovable) {
+        removeChildList(node, node.items);
+        return VISIT_CHILDREN;
+    }
+
+    ShouldVisitChildren handle(const BlockStatementSyntax& node, bool isNodeRemovable) {
+        removeChildList(node, node.items);
+        return VISIT_CHILDREN;
+    }
+
+    ShouldVisitChildren handle(const DataDeclarationSyntax& node, bool isNodeRemovable) {
+        removeNode(node, isNodeRemovable);
+        return DONT_VISIT_CHILDREN;
+    }
+
+    ShouldVisitChildren handle(const ContinuousAssignSyntax& node, bool isNodeRemovable) {
+        removeNode(node, isNodeRemovable);
+        return DONT_VISIT_CHILDREN;
+    }
+};
+
+static std::string readFile(const fs::path& file) {
+    std::ifstream input(file, std::ios::binary);
+    return {std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>()};
+}
+
+static void writeFile(const fs::path& file, const std::string& text) {
+    std::ofstream output;
+    output.rdbuf()->pubsetbuf(0, 0);  // like SvBugpoint::writeTmpFile()
+    output.open(file);
+    output << text;
+}
+
+using Clock = std::chrono::steady_clock;
+using Ms = std::chrono::duration<double, std::milli>;
+
+int main(int argc, char** argv) {
+    const char* input = argc > 1 ? argv[1] : "tests/input_files/caliptra_in.sv";
+    int n = argc > 2 ? std::atoi(argv[2]) : 1;
+    auto treeOrErr = SyntaxTree::fromFile(input);
+    if (!treeOrErr) {
+        fprintf(stderr, "failed to load '%s'\n", input);
+        return 1;
+    }
+    auto tree = *treeOrErr;
+    // rewriter logs removed nodes to std::cerr, which is not what we measure
+    std::cerr.rdbuf(nullptr);
+
+    auto dir = fs::temp_directory_path() / ("splice-bench-" + std::to_string(getpid()));
+    fs::create_directories(dir);
+    auto base = dir / "base.sv", printed = dir / "printed.sv", spliced = dir / "spliced.sv";
+    writeFile(base, SyntaxPrinter::printFile(*tree));
+
+    Ms printMs{0}, spliceMs{0}, verifyMs{0};
+    size_t attempts = 0, splicedAttempts = 0, mismatches = 0;
+    ItemRemover rewriter;
+    rewriter.treeIndex = std::make_shared<TreeIndex>(tree);
+    while (!rewriter.traversalDone) {
+        auto stats = AttemptStats("1", "bodyRemover", nullptr);
+        auto tmpTree = rewriter.transform(tree, stats, n);
+        if (rewriter.traversalDone && tmpTree == tree) {
+            break;
+        }
+        attempts++;
+        auto start = Clock::now();
+        writeFile(printed, SyntaxPrinter::printFile(*tmpTree));
+        printMs += Clock::now() - start;
+
+        if (rewriter.textPatch) {
+            start = Clock::now();
+            bool ok = spliceFile(base, *rewriter.textPatch, spliced);
+            spliceMs += Clock::now() - start;
+            start = Clock::now();
+            ok &= readFile(spliced) == SyntaxPrinter::printFile(*tmpTree);
+            verifyMs += Clock::now() - start;
+            splicedAttempts++;
+            mismatches += !ok;
+        }
+        rewriter.moveToPoint(rewriter.checkPoints.back().childOrSibling);
+    }
+    fs::remove_all(dir);
+    if (mismatches) {
+        fprintf(stderr, "%zu of %zu spliced attempts differ from printed tree\n", mismatches,
+                splicedAttempts);
+        return 1;
+    }
+
+    size_t spliceCount = std::max<size_t>(splicedAttempts, 1);
+    printf("attempts (batch size %d):\t%zu (%zu spliced, all exact)\n", n, attempts,
+           splicedAttempts);
+    printf("printed attempt:\t%.3fms\n", printMs.count() / std::max<size_t>(attempts, 1));
+    printf("spliced attempt:\t%.3fms\n", spliceMs.count() / spliceCount);
+    printf("spliced and verified attempt:\t%.3fms\n",
+           (spliceMs + verifyMs).count() / spliceCount);
+    return 0;
+}
@@ -0,0 +1,146 @@
+// SPDX-License-Identifier: Apache-2.0
+// Measure cost of IncrementalRewriter attempts (transform() plus printing the transformed tree)
+// over a whole stage, with TreeIndex shared by all attempts on given tree (as done by
+// SvBugpoint::getTreeIndex()), versus getting line counts anew for each attempt, i.e. with
+// index rebuilt on every transform, and versus counting lines of each visited candidate
+// with toString() (as done before TreeIndex). The latter still uses the index to skip
+// subtrees, so it underestimates the cost of the old code.
+// Each attempt is treated as failed, so all of them transform the same tree.
+//
+// usage: tree-index-bench [input.sv] [iterations] [batch size]
+#include <slang/syntax/SyntaxPrinter.h>
+#include <slang/syntax/SyntaxTree.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include "../source/IncrementalRewriter.hpp"
+
+class DeclarationRemover : public IncrementalRewriter<DeclarationRemover> {
+    // subset of DeclRemover and StatementsRemover, to have candidates of all sizes
+   public:
+    // count lines of each candidate with toString(), like shouldRemove() did before TreeIndex
+    bool countLinesByPrinting = false;
+    size_t lineCountMismatches = 0;
+
+    ShouldVisitChildren handle(const ModuleDeclarationSyntax& node, bool isNodeRemovable) {
+        tryRemove(node, isNodeRemovable);
+        return VISIT_CHILDREN;
+    }
+
+    ShouldVisitChildren handle(const FunctionDeclarationSyntax& node, bool isNodeRemovable) {
+        tryRemove(node, isNodeRemovable);
+        return VISIT_CHILDREN;
+    }
+
+    ShouldVisitChildren handle(const DataDeclarationSyntax& node, bool isNodeRemovable) {
+        tryRemove(node, isNodeRemovable);
+        return DONT_VISIT_CHILDREN;
+    }
+
+    ShouldVisitChildren handle(const ContinuousAssignSyntax& node, bool isNodeRemovable) {
+        tryRemove(node, isNodeRemovable);
+        return DONT_VISIT_CHILDREN;
+    }
+
+   private:
+    template <typename T>
+    void tryRemove(const T& node, bool isNodeRemovable) {
+        if (countLinesByPrinting) {
+            unsigned len = std::ranges::count(node.toString(), '\n') + 1;
+            lineCountMismatches += len != treeIndex->lineCount(node);
+        }
+        removeNode(node, isNodeRemovable);
+    }
+};
+
+struct StageResult {
+    size_t attempts = 0;
+    size_t printedBytes = 0;
+    size_t lineCountMismatches = 0;
+};
+
+template <typename GetIndex>
+static StageResult runStage(const std::shared_ptr<SyntaxTree>& tree,
+                            GetIndex getIndex,
+                            int n,
+                            bool countLinesByPrinting = false) {
+    // Try all candidates of the stage in batches of n, each as if the previous one failed
+    StageResult result;
+    DeclarationRemover rewriter;
+    rewriter.countLinesByPrinting = countLinesByPrinting;
+    while (!rewriter.traversalDone) {
+        rewriter.treeIndex = getIndex();
+        auto stats = AttemptStats("1", "declarationRemover", nullptr);
+        auto tmpTree = rewriter.transform(tree, stats, n);
+        if (rewriter.traversalDone && tmpTree == tree) {
+            break;
+        }
+        result.attempts++;
+        result.printedBytes += SyntaxPrinter::printFile(*tmpTree).size();
+        rewriter.moveToPoint(rewriter.checkPoints.back().childOrSibling);
+    }
+    result.lineCountMismatches = rewriter.lineCountMismatches;
+    return result;
+}
+
+template <typename Func>
+static double measureMs(Func func, int iterations) {
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++) {
+        func();
+    }
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() / iterations;
+}
+
+int main(int argc, char** argv) {
+    const char* input = argc > 1 ? argv[1] : "tests/input_files/caliptra_in.sv";
+    int iterations = argc > 2 ? std::atoi(argv[2]) : 3;
+    int n = argc > 3 ? std::atoi(argv[3]) : 32;
+    auto treeOrErr = SyntaxTree::fromFile(input);
+    if (!treeOrErr) {
+        fprintf(stderr, "failed to load '%s'\n", input);
+        return 1;
+    }
+    auto tree = *treeOrErr;
+    // rewriter logs removed nodes to std::cerr, which is not what we measure
+    std::cerr.rdbuf(nullptr);
+
+    auto shared = std::make_shared<TreeIndex>();
+    double buildMs = measureMs([&] { shared->build(tree); }, iterations);
+
+    StageResult sharedResult, rebuiltResult, printedResult;
+    double sharedMs =
+        measureMs([&] { sharedResult = runStage(tree, [&] { return shared; }, n); }, iterations);
+    double rebuiltMs = measureMs(
+        [&] {
+            rebuiltResult = runStage(tree, [&] { return std::make_shared<TreeIndex>(tree); }, n);
+        },
+        iterations);
+    double printedMs = measureMs(
+        [&] { printedResult = runStage(tree, [&] { return shared; }, n, true); }, iterations);
+    for (auto& result : {rebuiltResult, printedResult}) {
+        if (sharedResult.attempts != result.attempts ||
+            sharedResult.printedBytes != result.printedBytes) {
+            fprintf(stderr, "attempts differ: %zu (%zu bytes) vs %zu (%zu bytes)\n",
+                    sharedResult.attempts, sharedResult.printedBytes, result.attempts,
+                    result.printedBytes);
+            return 1;
+        }
+    }
+    if (printedResult.lineCountMismatches) {
+        fprintf(stderr, "%zu line counts of TreeIndex differ from toString() ones\n",
+                printedResult.lineCountMismatches);
+        return 1;
+    }
+
+    size_t attempts = std::max<size_t>(sharedResult.attempts, 1);
+    printf("attempts per stage (batch size %d):\t%zu\n", n, sharedResult.attempts);
+    printf("shared TreeIndex per attempt:\t%.2fms\n", sharedMs / attempts);
+    printf("rebuilt TreeIndex per attempt:\t%.2fms\n", rebuiltMs / attempts);
+    printf("toString() line counts per attempt:\t%.2fms\n", printedMs / attempts);
+    printf("TreeIndex build (per tree):\t%.1fms\n", buildMs);
+    return 0;
+}
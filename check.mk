@@ -12,7 +12,7 @@ autofix: autofmt shellcheck_autofix
 
 .PHONY: autofmt
 autofmt:
-	clang-format-15 -i source/*.cpp source/*.hpp
+	clang-format-15 -i source/*.cpp source/*.hpp bench/*.cpp
 
 .PHONY: test
 test:
@@ -24,7 +24,7 @@ lint: fmt_check shellcheck
 .PHONY: fmt_check
 fmt_check:
 	FMT_FAILED=0; \
-	for i in source/*.cpp source/*.hpp; do \
+	for i in source/*.cpp source/*.hpp bench/*.cpp; do \
 	  diff "$$i" <(clang-format-15 "$$i")  --label "original $$i" --label "formatted $$i" --color=always -u || FMT_FAILED=1; \
 	done; \
 	exit "$$FMT_FAILED"
@@ -0,0 +1,51 @@
+#!/usr/bin/env python3
+"""
+SPDX-License-Identifier: Apache-2.0
+
+check server variant of sv-bugpoint-check.py (use with sv-bugpoint --check-server)
+
+Python interpreter is started only once, and then each attempt is received as a line
+with tab-separated file paths on stdin. Verdict (0 - error message preserved) is printed
+on stdout, so anything else has to go to stderr.
+"""
+
+import os
+import shlex
+import subprocess
+import sys
+
+CMD = """
+verilator --cc --autoflush --timescale 1ns/1ps --timing --top-module caliptra_top_tb \
+  -Wno-WIDTH -Wno-UNOPTFLAT -Wno-LITENDIAN -Wno-CMPCONST -Wno-MULTIDRIVEN -Wno-UNPACKED -Wno-ALWCOMBORDER
+"""
+
+# separate file for each worker, so it is safe to use with -j
+ACTUAL_STDERR = f"actual_stderr.{os.environ.get('SV_BUGPOINT_WORKER', '0')}"
+
+
+def verilate_and_save_errmsg(verilator_argv):
+    """run verilator, strip out volatile metadata from stderr and save it to file"""
+    with open(ACTUAL_STDERR, "w", encoding="utf-8") as actual:
+        subprocess.Popen(
+            ["sv-bugpoint-strip-verilator-errmsg"],
+            stdin=subprocess.Popen(
+                verilator_argv, stdout=subprocess.DEVNULL, stderr=subprocess.PIPE
+            ).stderr,
+            stdout=actual,
+        ).communicate()
+
+
+def check():
+    """check if actual equals golden, print diff (to stderr) if not"""
+    diff_proc = subprocess.run(
+        ["diff", "golden_stderr", ACTUAL_STDERR, "--color"],
+        stdout=sys.stderr,
+        check=False,
+    )
+    return diff_proc.returncode == 0
+
+
+for line in sys.stdin:
+    files = line.rstrip("\n").split("\t")
+    verilate_and_save_errmsg(shlex.split(CMD) + files)
+    print(0 if check() else 1, flush=True)
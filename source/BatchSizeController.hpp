@@ -0,0 +1,44 @@
+// SPDX-License-Identifier: Apache-2.0
+#pragma once
+#include <algorithm>
+#include <cstddef>
+
+// Chooses how many reductions of a stage are merged into a single attempt.
+//
+// Stages differ a lot in how often their reductions pass: e.g. most of bodyRemover's ones
+// do, while memberRemover fails often, so fixed batch size is either too small for the former
+// or too large (and wastes attempts on bisection) for the latter. The batch grows
+// exponentially while attempts pass, and on failure it shrinks at least by half, or to the
+// number of consecutive passing reductions expected from commit ratio observed so far.
+class BatchSizeController {
+   public:
+    static constexpr size_t maxSize = 1024;
+
+    // initial <= 1 disables merging
+    explicit BatchSizeController(size_t initial)
+        : size(std::max<size_t>(initial, 1)), disabled(initial <= 1), tried(0), committed(0) {}
+
+    size_t get() const { return disabled ? 1 : size; }
+
+    // all n reductions of an attempt passed
+    void recordSuccess(size_t n) {
+        tried += n;
+        committed += n;
+        size = std::min(size * 2, maxSize);
+    }
+
+    // attempt failed, and bisection found that n reductions preceding the culprit pass
+    void recordFailure(size_t n) {
+        tried += n + 1;
+        committed += n;
+        // for commit ratio p, the expected run of passing reductions is p / (1 - p)
+        size_t expectedRun = committed / (tried - committed);
+        size = std::max<size_t>(1, std::min(size / 2, expectedRun));
+    }
+
+   private:
+    size_t size;
+    bool disabled;
+    size_t tried;
+    size_t committed;
+};
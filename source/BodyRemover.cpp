@@ -38,3 +38,7 @@ template bool rewriteLoop<BodyRemover>(std::shared_ptr<SyntaxTree>& tree,
                                        std::string stageName,
                                        std::string passIdx,
                                        SvBugpoint* svBugpoint);
+template std::unique_ptr<CandidateProducer> makeCandidateProducer<BodyRemover>(
+    const std::string& stageName,
+    SvBugpoint* svBugpoint,
+    std::shared_ptr<TreeIndex> treeIndex);
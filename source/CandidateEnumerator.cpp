@@ -0,0 +1,33 @@
+// SPDX-License-Identifier: Apache-2.0
+#include "CandidateEnumerator.hpp"
+#include "Utils.hpp"
+
+static void enumerateNode(const SyntaxNode& node,
+                          bool isNodeRemovable,
+                          std::span<CandidateProducer* const> producers,
+                          uint64_t active) {
+    // active: mask of producers that are interested in the node
+    uint64_t activeChildren = 0;
+    for (size_t i = 0; i < producers.size(); i++) {
+        if ((active >> i & 1) && producers[i]->collect(node, isNodeRemovable)) {
+            activeChildren |= uint64_t(1) << i;
+        }
+    }
+    if (!activeChildren) {
+        return;
+    }
+    for (uint32_t i = 0; i < node.getChildCount(); i++) {
+        if (auto child = node.childNode(i)) {
+            enumerateNode(*child, node.isChildOptional(i), producers, activeChildren);
+        }
+    }
+}
+
+void enumerateCandidates(const SyntaxNode& root, std::span<CandidateProducer* const> producers) {
+    if (producers.size() > 64) {
+        PRINTF_ERR("too many candidate producers (%zu)\n", producers.size());
+        exit(1);
+    }
+    uint64_t all = producers.size() == 64 ? ~uint64_t(0) : (uint64_t(1) << producers.size()) - 1;
+    enumerateNode(root, true, producers, all);
+}
@@ -0,0 +1,37 @@
+// SPDX-License-Identifier: Apache-2.0
+#pragma once
+#include <slang/syntax/SyntaxNode.h>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <vector>
+
+using namespace slang::syntax;
+using namespace slang;
+
+// Node to be rewritten by a stage, queued in the order of size (see IncrementalRewriter)
+struct RewriteCandidate {
+    unsigned lines;
+    size_t order;  // position in traversal
+    SourceRange rewritePoint;
+    bool operator<(const RewriteCandidate& rhs) const {
+        // the largest, and then the first one in traversal, goes to the back
+        return lines != rhs.lines ? lines < rhs.lines : order > rhs.order;
+    }
+};
+
+// Rewriter of a stage in collecting mode, that is given nodes one by one (see
+// enumerateCandidates()) instead of traversing the tree by itself.
+class CandidateProducer {
+   public:
+    virtual ~CandidateProducer() = default;
+    // Collect candidates at given node (but not its descendants).
+    // Return whether its descendants should be given too.
+    virtual bool collect(const SyntaxNode& node, bool isNodeRemovable) = 0;
+    // Collected candidates, sorted as expected by IncrementalRewriter::transformQueued()
+    virtual std::vector<RewriteCandidate> takeCandidates() = 0;
+};
+
+// Collect candidates of all producers (at most 64) in a single traversal of the tree, rather
+// than a traversal per stage
+void enumerateCandidates(const SyntaxNode& root, std::span<CandidateProducer* const> producers);
@@ -0,0 +1,119 @@
+// SPDX-License-Identifier: Apache-2.0
+#include "CheckServer.hpp"
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include "Spawn.hpp"
+#include "Utils.hpp"
+
+void CheckServer::start(const std::string& script, int worker) {
+    this->script = script;
+    int requestPipe[2], replyPipe[2];
+    // O_CLOEXEC keeps the pipes from leaking into other children (e.g. servers of other workers)
+    if (pipe2(requestPipe, O_CLOEXEC) || pipe2(replyPipe, O_CLOEXEC)) {
+        PRINTF_ERR("pipe failed: %s\n", strerror(errno));
+        exit(1);
+    }
+    // dead server should be reported as an error, rather than kill us on write
+    signal(SIGPIPE, SIG_IGN);
+
+    pid = spawnProcess({script},
+                       {"SV_BUGPOINT_SERVER=1", "SV_BUGPOINT_WORKER=" + std::to_string(worker)},
+                       {{requestPipe[0], STDIN_FILENO}, {replyPipe[1], STDOUT_FILENO}});
+    if (pid == -1) {
+        PRINTF_ERR("failed to launch '%s': %s\n", script.c_str(), strerror(errno));
+        exit(1);
+    }
+
+    close(requestPipe[0]);
+    close(replyPipe[1]);
+    requestFd = requestPipe[1];
+    replies = fdopen(replyPipe[0], "r");
+}
+
+void CheckServer::stop() {
+    if (pid == -1) {
+        return;
+    }
+    close(requestFd);  // EOF on stdin asks server to exit
+    fclose(replies);
+    waitpid(pid, nullptr, 0);
+    forgetProcess(pid);
+    pid = -1;
+}
+
+void CheckServer::forceStop() {
+    if (pid != -1) {
+        kill(-pid, SIGKILL);
+    }
+    stop();
+}
+
+void CheckServer::send(const std::vector<std::string>& files) {
+    std::string request;
+    for (auto& file : files) {
+        request += (request.empty() ? "" : "\t") + file;
+    }
+    request += '\n';
+
+    size_t written = 0;
+    while (written < request.size()) {
+        ssize_t rc = write(requestFd, request.data() + written, request.size() - written);
+        if (rc < 0 && errno == EINTR) {
+            continue;
+        }
+        if (rc < 0) {
+            PRINTF_ERR("failed to send request to check server '%s': %s\n", script.c_str(),
+                       strerror(errno));
+            exit(1);
+        }
+        written += rc;
+    }
+}
+
+bool CheckServer::waitForReply(
+    std::chrono::time_point<std::chrono::high_resolution_clock> deadline) {
+    // NOTE: there is at most one request in flight, so nothing is left in replies buffer
+    // after the previous reply, and polling underlying fd is enough
+    struct pollfd fd = {fileno(replies), POLLIN, 0};
+    while (true) {
+        auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+            deadline - std::chrono::high_resolution_clock::now());
+        if (remaining.count() <= 0) {
+            return false;
+        }
+        int rc = poll(&fd, 1, remaining.count() + 1);
+        if (rc > 0) {
+            return true;  // either reply or EOF, receive() will tell
+        } else if (rc < 0 && errno != EINTR) {
+            PRINTF_ERR("poll failed: %s\n", strerror(errno));
+            exit(1);
+        }
+    }
+}
+
+bool CheckServer::receive() {
+    // Return true if server reported that the property is preserved
+    char* line = nullptr;
+    size_t len = 0;
+    ssize_t rc = getline(&line, &len, replies);
+    std::string reply = rc > 0 ? std::string(line, rc) : "";
+    free(line);
+    if (rc <= 0) {
+        PRINTF_ERR("check server '%s' exited without replying\n", script.c_str());
+        exit(1);
+    }
+
+    char* end;
+    long status = strtol(reply.c_str(), &end, 10);
+    if (end == reply.c_str()) {
+        PRINTF_ERR("unexpected reply from check server '%s': %s", script.c_str(), reply.c_str());
+        exit(1);
+    }
+    return status == 0;
+}
@@ -0,0 +1,41 @@
+// SPDX-License-Identifier: Apache-2.0
+#pragma once
+#include <sys/types.h>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// Long-lived check script instance that is fed with attempts over a pipe.
+//
+// The protocol is line-based: for each attempt, a line with paths of input files (separated
+// by tabs) is written to script's stdin, and script answers with a line containing a single
+// integer on its stdout - 0 if the property is preserved, non-zero otherwise (the same as exit
+// code of regular check script). The script is started without arguments, and with
+// SV_BUGPOINT_SERVER=1 set in its environment. Closing its stdin means there will be no more
+// requests.
+class CheckServer {
+   public:
+    CheckServer() : pid(-1), requestFd(-1), replies(nullptr) {}
+    ~CheckServer() { stop(); }
+    CheckServer(const CheckServer&) = delete;
+    CheckServer& operator=(const CheckServer&) = delete;
+
+    void start(const std::string& script, int worker);
+    void stop();
+    // kill server together with everything it has spawned
+    void forceStop();
+    bool isRunning() const { return pid != -1; }
+
+    void send(const std::vector<std::string>& files);
+    // return false if there is no reply until the deadline
+    bool waitForReply(std::chrono::time_point<std::chrono::high_resolution_clock> deadline);
+    bool receive();
+
+    pid_t pid;
+
+   private:
+    int requestFd;
+    FILE* replies;
+    std::string script;
+};
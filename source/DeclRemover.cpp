@@ -83,3 +83,7 @@ template bool rewriteLoop<DeclRemover>(std::shared_ptr<SyntaxTree>& tree,
                                        std::string stageName,
                                        std::string passIdx,
                                        SvBugpoint* svBugpoint);
+template std::unique_ptr<CandidateProducer> makeCandidateProducer<DeclRemover>(
+    const std::string& stageName,
+    SvBugpoint* svBugpoint,
+    std::shared_ptr<TreeIndex> treeIndex);
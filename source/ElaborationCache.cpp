@@ -0,0 +1,19 @@
+// SPDX-License-Identifier: Apache-2.0
+#include "ElaborationCache.hpp"
+
+Compilation& ElaborationCache::get(const std::shared_ptr<SyntaxTree>& tree) {
+    if (compilation && this->tree == tree) {
+        return *compilation;
+    }
+    clear();
+    compilation = std::make_unique<Compilation>();
+    compilation->addSyntaxTree(tree);
+    compilation->getAllDiagnostics();
+    this->tree = tree;
+    return *compilation;
+}
+
+void ElaborationCache::clear() {
+    compilation.reset();
+    tree = nullptr;
+}
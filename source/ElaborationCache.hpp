@@ -0,0 +1,25 @@
+// SPDX-License-Identifier: Apache-2.0
+#pragma once
+#include <slang/ast/Compilation.h>
+#include <slang/syntax/SyntaxTree.h>
+#include <memory>
+
+using namespace slang::ast;
+using namespace slang::syntax;
+
+// Elaborated compilation of a tree, shared by reducers that map AST symbols back to syntax
+// (e.g. a port to all its connections).
+//
+// Full elaboration of a large design takes seconds, while such reducers ask for the same
+// tree many times (each stage in a pass, and externInliner on each attempt). The compilation
+// is kept until it is requested for another tree, i.e. until a commit.
+class ElaborationCache {
+   public:
+    // Compilation of given tree, with all diagnostics computed (which forces full elaboration)
+    Compilation& get(const std::shared_ptr<SyntaxTree>& tree);
+    void clear();
+
+   private:
+    std::shared_ptr<SyntaxTree> tree;
+    std::unique_ptr<Compilation> compilation;
+};
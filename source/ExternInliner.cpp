@@ -12,15 +12,19 @@ static bool hasExternQualifier(const TokenList& qualifiers) {
     return false;
 }
 
+// Nodes are identified by their source ranges (and kinds), that are kept by tree transforms,
+// so the map has to be built (which requires elaboration) only once.
 struct ExternInlineCandidate {
     // Clone the declaration body, but remove the whole source node that owns it.
-    not_null<const FunctionDeclarationSyntax*> implementationDecl;
-    not_null<const SyntaxNode*> implementationRemovalNode;
+    SourceRange implementationDecl;
+    SyntaxKind implementationDeclKind;
+    SourceRange implementationRemovalNode;
+    SyntaxKind implementationRemovalNodeKind;
     std::string methodName;
 };
 
-using ExternInlineMap =
-    std::unordered_map<const ClassMethodPrototypeSyntax*, ExternInlineCandidate>;
+// keyed by source range of prototype
+using ExternInlineMap = std::unordered_map<SourceRange, ExternInlineCandidate>;
 
 class ExternInlineMapper final : public ASTVisitor<ExternInlineMapper, true, true, true> {
    public:
@@ -54,19 +58,17 @@ class ExternInlineMapper final : public ASTVisitor<ExternInlineMapper, true, tru
             implNode != protoSyntax &&
             (implDecl->kind == SyntaxKind::FunctionDeclaration ||
              implDecl->kind == SyntaxKind::TaskDeclaration)) {
-            candidates.emplace(protoSyntax,
-                               ExternInlineCandidate{implDecl, implNode, std::string(proto.name)});
+            candidates.emplace(protoSyntax->sourceRange(),
+                               ExternInlineCandidate{implDecl->sourceRange(), implDecl->kind,
+                                                     implNode->sourceRange(), implNode->kind,
+                                                     std::string(proto.name)});
         }
 
         visitDefault(proto);
     }
 };
 
-static ExternInlineMap makeExternInlineMap(const std::shared_ptr<SyntaxTree>& tree) {
-    Compilation compilation;
-    compilation.addSyntaxTree(tree);
-    compilation.getAllDiagnostics();
-
+static ExternInlineMap makeExternInlineMap(Compilation& compilation) {
     ExternInlineMapper mapper;
     compilation.getRoot().visit(mapper);
     return std::move(mapper.candidates);
@@ -77,9 +79,12 @@ class ExternInliner : public IncrementalRewriter<ExternInliner> {
     std::shared_ptr<SyntaxTree> transform(const std::shared_ptr<SyntaxTree> tree,
                                           AttemptStats& stats,
                                           int n = 1) {
-        // transform() copies the syntax tree, so pointers found during earlier attempts are stale.
-        // Rebuild the map on every attempt to point at nodes from the current tree.
-        candidateByPrototype = makeExternInlineMap(tree);
+        // transform() copies the syntax tree, so the map refers to nodes by their ranges,
+        // and they are looked up in the current tree on each attempt
+        if (!candidatesMapped) {
+            candidateByPrototype = makeExternInlineMap(svBugpoint->getCompilation(tree));
+            candidatesMapped = true;
+        }
         currentClassNode = nullptr;
         return IncrementalRewriter<ExternInliner>::transform(tree, stats, n);
     }
@@ -100,14 +105,21 @@ class ExternInliner : public IncrementalRewriter<ExternInliner> {
             return VISIT_CHILDREN;
         }
 
-        auto it = candidateByPrototype.find(&node);
+        auto it = candidateByPrototype.find(node.sourceRange());
         if (it == candidateByPrototype.end()) {
             return VISIT_CHILDREN;
         }
+        auto implementationDecl =
+            treeIndex->findNode(it->second.implementationDecl, it->second.implementationDeclKind);
+        auto implementationRemovalNode = treeIndex->findNode(
+            it->second.implementationRemovalNode, it->second.implementationRemovalNodeKind);
+        if (!implementationDecl || !implementationRemovalNode) {
+            return VISIT_CHILDREN;  // implementation was removed by an earlier commit
+        }
 
         bool removedExtern = false;
-        auto& replacement =
-            createInlinedMember(node, *it->second.implementationDecl, removedExtern);
+        auto& replacement = createInlinedMember(
+            node, implementationDecl->as<FunctionDeclarationSyntax>(), removedExtern);
         if (!removedExtern) {
             return VISIT_CHILDREN;
         }
@@ -118,7 +130,7 @@ class ExternInliner : public IncrementalRewriter<ExternInliner> {
 
         logType<ClassMethodPrototypeSyntax>();
         std::cerr << prefixLines(node.toString(), "-") << "\n";
-        std::cerr << prefixLines(it->second.implementationRemovalNode->toString(), "-") << "\n";
+        std::cerr << prefixLines(implementationRemovalNode->toString(), "-") << "\n";
         std::cerr << prefixLines(replacement.toString(), "+") << "\n";
 
         if (!it->second.methodName.empty()) {
@@ -128,16 +140,17 @@ class ExternInliner : public IncrementalRewriter<ExternInliner> {
         // Remove the extern declaration and place the inlined method at the end of the class,
         // so member accesses remain valid even if fields are declared below the prototype.
         insertAtBack(currentClassNode->items, replacement);
+        textPatch.reset();  // insertion isn't tracked as text edit
         remove(node);
-        remove(*it->second.implementationRemovalNode);
+        remove(*implementationRemovalNode);
 
-        checkPoints.push_back({node.sourceRange()});
-        state = REGISTER_CHILD;
+        addCheckPoint(node.sourceRange());
         return DONT_VISIT_CHILDREN;
     }
 
    private:
     ExternInlineMap candidateByPrototype;
+    bool candidatesMapped = false;
     const ClassDeclarationSyntax* currentClassNode = nullptr;
 
     TokenList& cloneQualifiersWithoutExtern(const TokenList& qualifiers,
@@ -0,0 +1,92 @@
+// SPDX-License-Identifier: Apache-2.0
+#pragma once
+#include <slang/text/SourceLocation.h>
+#include <algorithm>
+#include <map>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+using namespace slang;
+
+// Reductions that were proven to fail, grouped by their enclosing declaration.
+//
+// In later passes most attempts retry reductions that already failed, even though nothing
+// near them has changed. Failures are forgotten once their enclosing declaration (or any
+// declaration nested in it) is modified, so they are retried only after a nearby change.
+// It is a heuristic: reduction may start to pass after a change in an unrelated declaration
+// too (e.g. removing the last instantiation of a module), so a final pass has to retry all
+// of them anyway.
+//
+// Reductions are identified by source ranges of rewritten nodes, which are kept by tree
+// transforms, but not by reparsing the file, so the memo has to be cleared on reload.
+class FailureMemo {
+   public:
+    bool knownToFail(const std::string& stage,
+                     SourceRange rewritePoint,
+                     SourceRange declaration) const {
+        auto it = failures.find(declaration);
+        if (it == failures.end()) {
+            return false;
+        }
+        auto stageIt = it->second.find(stage);
+        return stageIt != it->second.end() && stageIt->second.contains(rewritePoint);
+    }
+
+    void recordFailure(const std::string& stage,
+                       SourceRange rewritePoint,
+                       SourceRange declaration) {
+        failures[declaration][stage].insert(rewritePoint);
+    }
+
+    // Sets of nodes removed at once (see SetRemover) may span many declarations, so a failed
+    // set is recorded under each declaration enclosing its nodes, and forgotten once any of
+    // them is modified.
+    bool knownToFail(const std::string& stage,
+                     const std::vector<SourceRange>& set,
+                     std::span<const SourceRange> declarations) const {
+        if (declarations.empty()) {
+            return false;
+        }
+        for (auto declaration : declarations) {
+            auto it = failedSets.find(declaration);
+            if (it == failedSets.end()) {
+                return false;
+            }
+            auto stageIt = it->second.find(stage);
+            if (stageIt == it->second.end() ||
+                std::find(stageIt->second.begin(), stageIt->second.end(), set) ==
+                    stageIt->second.end()) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void recordFailure(const std::string& stage,
+                       const std::vector<SourceRange>& set,
+                       std::span<const SourceRange> declarations) {
+        for (auto declaration : declarations) {
+            failedSets[declaration][stage].push_back(set);
+        }
+    }
+
+    // Forget failures of reductions whose enclosing declaration is the given one
+    void markModified(SourceRange declaration) {
+        failures.erase(declaration);
+        failedSets.erase(declaration);
+    }
+
+    void clear() {
+        failures.clear();
+        failedSets.clear();
+    }
+
+   private:
+    std::unordered_map<SourceRange, std::map<std::string, std::unordered_set<SourceRange>>>
+        failures;
+    std::unordered_map<SourceRange, std::map<std::string, std::vector<std::vector<SourceRange>>>>
+        failedSets;
+};
@@ -57,6 +57,10 @@ template bool rewriteLoop<IfBodyReplacer>(std::shared_ptr<SyntaxTree>& tree,
                                           std::string stageName,
                                           std::string passIdx,
                                           SvBugpoint* svBugpoint);
+template std::unique_ptr<CandidateProducer> makeCandidateProducer<IfBodyReplacer>(
+    const std::string& stageName,
+    SvBugpoint* svBugpoint,
+    std::shared_ptr<TreeIndex> treeIndex);
 
 class ElseBodyReplacer : public IncrementalRewriter<ElseBodyReplacer> {
    public:
@@ -85,3 +89,7 @@ template bool rewriteLoop<ElseBodyReplacer>(std::shared_ptr<SyntaxTree>& tree,
                                             std::string stageName,
                                             std::string passIdx,
                                             SvBugpoint* svBugpoint);
+template std::unique_ptr<CandidateProducer> makeCandidateProducer<ElseBodyReplacer>(
+    const std::string& stageName,
+    SvBugpoint* svBugpoint,
+    std::shared_ptr<TreeIndex> treeIndex);
@@ -1,7 +1,14 @@
 // SPDX-License-Identifier: Apache-2.0
 #include <slang/syntax/SyntaxVisitor.h>
+#include <algorithm>
 #include <iosfwd>
+#include <unordered_set>
+#include "CandidateEnumerator.hpp"
+#include "FailureMemo.hpp"
+#include "RewriteQueue.hpp"
 #include "SvBugpoint.hpp"
+#include "TextSplice.hpp"
+#include "TreeIndex.hpp"
 #include "Utils.hpp"
 #include "slang/text/SourceLocation.h"
 
@@ -48,10 +55,59 @@ class IncrementalRewriter : public SyntaxRewriter<TDerived> {
     unsigned linesUpperLimit = INT_MAX;
     unsigned linesLowerLimit = 1024;
 
+    // Alternatively (if sizeOrdered is set), all candidates are collected in single traversal
+    // (unless they are given, see enumerateCandidates()), and consumed in the order of their
+    // size, starting from the largest one (see rewriteQueue).
+    bool sizeOrdered = false;
+    bool collecting = false;
+    bool collected = false;
+    std::vector<RewriteCandidate> queue;
+    // queue[0, remaining) are yet to be tried
+    size_t remaining = 0;
+    // Number of candidates applied by the last transform(), queue[remaining, remaining+appliedSets)
+    size_t appliedSets = 0;
+    // Rewrite points of candidates selected for the current transform(), that weren't
+    // rewritten yet
+    std::unordered_set<SourceRange> selected;
+    // Preorder positions of selected nodes. Subtrees that don't contain any of them are skipped.
+    std::vector<uint32_t> selectedPreorders;
+
     bool traversalDone = false;  // set once all line "windows" were tried
 
     std::string rewrittenTypeInfo;
 
+    // line counts and preorder positions of nodes of the tree that is being transformed
+    // (shared with other stages, see SvBugpoint::getTreeIndex())
+    std::shared_ptr<TreeIndex> treeIndex;
+    SvBugpoint* svBugpoint = nullptr;
+    // Preorder positions of nodes with startPoint range in the tree that is being transformed.
+    // Subtrees that don't contain any of them are not visited at all in SKIP_TO_START state.
+    std::span<const uint32_t> startPreorders;
+
+    // Edits of printed tree equivalent to rewrites done by the last transform(), which let
+    // SvBugpoint write the attempt without printing the whole tree.
+    // Rewrites that can't be expressed that way reset it.
+    std::optional<TextPatch> textPatch;
+
+    // Failed rewrites of the stage are recorded in failureMemo (if given), and unless
+    // skipKnownFailures is cleared, they are not tried again.
+    std::string stageName;
+    FailureMemo* failureMemo = nullptr;
+    bool skipKnownFailures = false;
+    // Declarations modified by commits not applied to failureMemo yet (see applyCommits())
+    std::vector<SourceRange> modifiedDeclarations;
+    bool modifiedUnknown = false;
+
+    // Collect candidates at given node alone (see CandidateProducer)
+    template <typename T>
+    bool collectNode(const T& node, bool isNodeRemovable) {
+        if constexpr (requires { DERIVED->handle(node, isNodeRemovable); }) {
+            return DERIVED->handle(node, isNodeRemovable) == VISIT_CHILDREN;
+        } else {
+            return true;
+        }
+    }
+
     /// Visit all child nodes
     template <typename T>
     void visitDefault(T&& node) {
@@ -70,6 +126,12 @@ class IncrementalRewriter : public SyntaxRewriter<TDerived> {
     // Visiting children can be disabled by returning DONT_VISIT_CHILDREN from handle()
     template <typename T>
     void visit(T&& node, bool isNodeRemovable = true) {
+        if (state == SKIP_TO_START && !treeIndex->subtreeContains(node, startPreorders)) {
+            return;
+        }
+        if (sizeOrdered && !collecting && !treeIndex->subtreeContains(node, selectedPreorders)) {
+            return;
+        }
         if (state == SKIP_TO_START && node.sourceRange() == startPoint) {
             state = REWRITE_ALLOWED;
         }
@@ -116,22 +178,91 @@ class IncrementalRewriter : public SyntaxRewriter<TDerived> {
 
     template <typename T>
     bool shouldRemove(const T& node, bool isNodeRemovable) {
-        unsigned len = std::ranges::count(node.toString(), '\n') + 1;
-        return state == REWRITE_ALLOWED && isNodeRemovable && len >= linesLowerLimit &&
-               len < linesUpperLimit;
+        return isNodeRemovable && shouldRewrite(node, node.sourceRange());
     }
 
     template <typename T>
-    bool shouldRemove(const SyntaxList<T>& list) {
-        unsigned len = std::ranges::count(list.toString(), '\n') + 1;
-        return state == REWRITE_ALLOWED && list.getChildCount() && len >= linesLowerLimit &&
-               len < linesUpperLimit;
+    bool shouldReplace(const T& node) {
+        return shouldRewrite(node, node.sourceRange());
     }
 
-    template <typename T>
-    bool shouldReplace(const T& node) {
-        unsigned len = std::ranges::count(node.toString(), '\n') + 1;
-        return state == REWRITE_ALLOWED && len >= linesLowerLimit && len < linesUpperLimit;
+    // Whether node should be rewritten now (in rewritePoint checkpoint)
+    bool shouldRewrite(const SyntaxNode& node, SourceRange rewritePoint) {
+        if (state != REWRITE_ALLOWED || knownToFail(rewritePoint)) {
+            return false;
+        }
+        if (collecting) {
+            queue.push_back({treeIndex->lineCount(node), queue.size(), rewritePoint});
+            return false;
+        }
+        if (sizeOrdered) {
+            return selected.contains(rewritePoint);
+        }
+        unsigned len = treeIndex->lineCount(node);
+        return len >= linesLowerLimit && len < linesUpperLimit;
+    }
+
+    bool knownToFail(SourceRange rewritePoint) const {
+        return skipKnownFailures && failureMemo &&
+               failureMemo->knownToFail(stageName, rewritePoint,
+                                        treeIndex->declarationOf(rewritePoint));
+    }
+
+    // Remember that rewrite at given point fails on its own
+    void recordFailure(SourceRange rewritePoint) {
+        if (failureMemo) {
+            failureMemo->recordFailure(stageName, rewritePoint,
+                                       treeIndex->declarationOf(rewritePoint));
+        }
+    }
+
+    // Remember declaration modified by committed rewrite (and declarations enclosing it), to
+    // forget failures within them on applyCommits()
+    void recordCommit(SourceRange rewritePoint) {
+        if (!failureMemo) {
+            return;
+        }
+        auto declaration = treeIndex->declarationOf(rewritePoint);
+        if (declaration == SourceRange::NoLocation) {
+            modifiedUnknown = true;  // don't know what has changed
+            return;
+        }
+        for (; declaration != SourceRange::NoLocation;
+             declaration = treeIndex->declarationOf(declaration)) {
+            modifiedDeclarations.push_back(declaration);
+        }
+    }
+
+    // Forget failures within declarations modified by commits recorded so far. It is deferred
+    // until bisection ends, as it counts rewritten nodes assuming that the same ones are picked
+    // on each attempt, so known failures can't stop being skipped in the middle of it.
+    void applyCommits() {
+        if (failureMemo && modifiedUnknown) {
+            failureMemo->clear();
+        } else if (failureMemo) {
+            for (auto declaration : modifiedDeclarations) {
+                failureMemo->markModified(declaration);
+            }
+        }
+        modifiedDeclarations.clear();
+        modifiedUnknown = false;
+    }
+
+    // Outcome of n candidates from the queue applied at once (see rewriteQueue)
+    void recordOutcome(size_t position, size_t n, bool passed) {
+        std::vector<SourceRange> applied;
+        for (size_t i = position; i < position + n; i++) {
+            if (!treeIndex->find(queue[i].rewritePoint).empty()) {
+                applied.push_back(queue[i].rewritePoint);  // not a no-op
+            }
+        }
+        if (passed) {
+            for (auto rewritePoint : applied) {
+                recordCommit(rewritePoint);
+            }
+        } else if (applied.size() == 1) {
+            recordFailure(applied[0]);
+        }
     }
 
     template <typename T>
@@ -149,22 +280,22 @@ class IncrementalRewriter : public SyntaxRewriter<TDerived> {
             logType<T>();
             std::cerr << prefixLines(node.toString(), "-") << "\n";
             DERIVED->remove(node);
-            checkPoints.push_back({node.sourceRange()});
-            state = REGISTER_CHILD;
+            addTextEdit(node);
+            addCheckPoint(node.sourceRange());
         }
     }
 
     template <typename TParent, typename TChild>
     void removeChildList(const TParent& parent, const SyntaxList<TChild>& childList) {
-        if (shouldRemove(childList)) {
+        if (childList.getChildCount() && shouldRewrite(childList, parent.sourceRange())) {
             logType<TParent>();
             for (auto item : childList) {
                 DERIVED->remove(*item);
+                addTextEdit(*item);
                 std::cerr << prefixLines(item->toString(), "-");
             }
             std::cerr << "\n";
-            checkPoints.push_back({parent.sourceRange()});
-            state = REGISTER_CHILD;
+            addCheckPoint(parent.sourceRange());
         }
     }
 
@@ -175,9 +306,32 @@ class IncrementalRewriter : public SyntaxRewriter<TDerived> {
             std::cerr << prefixLines(originalNode.toString(), "-") << "\n";
             std::cerr << prefixLines(newNode.toString(), "+") << "\n";
             DERIVED->replace(originalNode, newNode, preserveTrivia);
-            checkPoints.push_back({originalNode.sourceRange()});
-            state = REGISTER_CHILD;
+            if (preserveTrivia) {
+                textPatch.reset();  // trivia is merged by rewriter, don't try to mimic it
+            } else {
+                addTextEdit(originalNode, printForSplice(newNode));
+            }
+            addCheckPoint(originalNode.sourceRange());
+        }
+    }
+
+    void addCheckPoint(SourceRange rewritePoint) {
+        checkPoints.push_back({rewritePoint});
+        selected.erase(rewritePoint);
+        state = REGISTER_CHILD;
+    }
+
+    void addTextEdit(const SyntaxNode& node, std::string replacement = "") {
+        if (!textPatch) {
+            return;
+        }
+        auto range = treeIndex->textRange(node);
+        if (!range || treeIndex->isInSeparatedList(node)) {
+            textPatch.reset();
+            return;
         }
+        // nodes are rewritten in traversal order, so edits come sorted
+        textPatch->edits.push_back({range->first, range->second, std::move(replacement)});
     }
 
     bool advanceLineWindow() {
@@ -200,6 +354,15 @@ class IncrementalRewriter : public SyntaxRewriter<TDerived> {
         checkPoints.clear();
         rewriteLimit = n;
         rewrittenTypeInfo = "";
+        if (!treeIndex || !treeIndex->isBuiltFor(tree)) {
+            treeIndex = svBugpoint->getTreeIndex(tree);
+        }
+        if (sizeOrdered) {
+            return transformQueued(tree, stats, n);
+        }
+        // NOTE: if startPoint is not in the tree, nothing is visited (nor rewritten)
+        startPreorders = treeIndex->find(startPoint);
+        textPatch = TextPatch{treeIndex->textSize(), {}};
 
         auto tree2 = SyntaxRewriter<TDerived>::transform(tree);
 
@@ -209,9 +372,69 @@ class IncrementalRewriter : public SyntaxRewriter<TDerived> {
         }
 
         stats.typeInfo = rewrittenTypeInfo;
+        stats.batch = n;
         return tree2;
     }
 
+    std::shared_ptr<SyntaxTree> transformQueued(const std::shared_ptr<SyntaxTree> tree,
+                                                AttemptStats& stats,
+                                                size_t n) {
+        // Apply next n candidates from the queue (like SetRemover::transform())
+        if (!collected) {
+            // candidates are found with the same handlers that rewrite them
+            collecting = true;
+            SyntaxRewriter<TDerived>::transform(tree);
+            collecting = false;
+            collected = true;
+            std::sort(queue.begin(), queue.end());
+            remaining = queue.size();
+        }
+        while (true) {
+            checkPoints.clear();
+            rewrittenTypeInfo = "";
+            selected.clear();
+            selectedPreorders.clear();
+            // Candidates that are no longer in the tree (e.g. they were inside a removed node)
+            // are consumed along with the selected ones, as no-ops
+            for (appliedSets = 0; selected.size() < n && remaining > 0; appliedSets++) {
+                auto rewritePoint = queue[--remaining].rewritePoint;
+                auto preorders = treeIndex->find(rewritePoint);
+                if (!preorders.empty()) {
+                    selected.insert(rewritePoint);
+                    selectedPreorders.insert(selectedPreorders.end(), preorders.begin(),
+                                             preorders.end());
+                }
+            }
+            if (selected.empty()) {
+                traversalDone = true;
+                return tree;
+            }
+            std::sort(selectedPreorders.begin(), selectedPreorders.end());
+            size_t selectedCount = selected.size();
+            state = REWRITE_ALLOWED;
+            rewriteLimit = SIZE_MAX;
+            textPatch = TextPatch{treeIndex->textSize(), {}};
+
+            auto tree2 = SyntaxRewriter<TDerived>::transform(tree);
+
+            if (!selected.empty() && selectedCount > 1) {
+                // Some candidate is nested in another one, or it can't be rewritten anymore.
+                // Sort it out by applying them one by one.
+                remaining += appliedSets;
+                n = 1;
+                continue;
+            }
+            if (!selected.empty()) {
+                continue;
+            }
+
+            stats.typeInfo = rewrittenTypeInfo;
+            stats.batch = selectedCount;
+            traversalDone = remaining == 0;
+            return tree2;
+        }
+    }
+
     void moveToPoint(SourceRange point) {
         // Start next transform from suplied node
         startPoint = point;
@@ -222,6 +445,28 @@ class IncrementalRewriter : public SyntaxRewriter<TDerived> {
         }
     }
 
+    // Position of traversal, that allows to resume it after speculatively preparing
+    // further attempts
+    struct Cursor {
+        SourceRange startPoint;
+        State state;
+        unsigned linesUpperLimit;
+        unsigned linesLowerLimit;
+        bool traversalDone;
+    };
+
+    Cursor getCursor() const {
+        return {startPoint, state, linesUpperLimit, linesLowerLimit, traversalDone};
+    }
+
+    void setCursor(const Cursor& cursor) {
+        startPoint = cursor.startPoint;
+        state = cursor.state;
+        linesUpperLimit = cursor.linesUpperLimit;
+        linesLowerLimit = cursor.linesLowerLimit;
+        traversalDone = cursor.traversalDone;
+    }
+
     void retry() {
         // Start next transform from first rewritten node.
         // Meant to be run when you decide to rollback removal (i.e. you're discarding a
@@ -254,7 +499,7 @@ RewriteResult rewrite(TDerived& rewriter,
         return RewriteResult::NONE;  // no change - no reason to test
     }
 
-    if (svBugpoint->test(tmpTree, stats)) {
+    if (svBugpoint->test(tmpTree, stats, rewriter.textPatch)) {
         tree = tmpTree;
         return RewriteResult::PASS;
     } else {
@@ -274,6 +519,10 @@ size_t rewriteBisectFailed(TDerived& rewriter,
         return 0;
     }
 
+    if (svBugpoint->jobs > 1) {
+        return rewriteBisectFailedSpeculatively(rewriter, tree, stageName, passIdx, svBugpoint, n);
+    }
+
     using enum RewriteResult;
     size_t rewritten = rewriteBisect(rewriter, tree, stageName, passIdx, svBugpoint, n / 2, false);
     if (rewritten < n / 2) {
@@ -287,6 +536,65 @@ size_t rewriteBisectFailed(TDerived& rewriter,
     }
 }
 
+template <typename TDerived>
+size_t rewriteBisectFailedSpeculatively(TDerived& rewriter,
+                                        std::shared_ptr<SyntaxTree>& tree,
+                                        std::string stageName,
+                                        std::string passIdx,
+                                        SvBugpoint* svBugpoint,
+                                        size_t n) {
+    // Like rewriteBisectFailed, but check up to svBugpoint->jobs leading halves at once (first
+    // n/2 nodes, n/4 nodes, ...), each as if the previous (larger) one failed. Committing the
+    // first passing one gives the same result as descending into them one-by-one.
+    using Cursor = typename IncrementalRewriter<TDerived>::Cursor;
+    Cursor start = rewriter.getCursor();
+    std::vector<size_t> sizes;
+    std::vector<std::shared_ptr<SyntaxTree>> candidates;
+    std::vector<AttemptStats> candidateStats;
+    std::vector<Cursor> cursors;
+    std::vector<std::vector<CheckPoint>> checkPoints;
+    std::vector<std::optional<TextPatch>> patches;
+    for (size_t size = n / 2; size >= 1 && (int)candidates.size() < svBugpoint->jobs; size /= 2) {
+        rewriter.setCursor(start);
+        auto stats = AttemptStats(passIdx, stageName, svBugpoint);
+        auto tmpTree = rewriter.transform(tree, stats, size);
+        if (rewriter.traversalDone && tmpTree == tree) {
+            break;  // no change - no reason to test
+        }
+        sizes.push_back(size);
+        candidates.push_back(tmpTree);
+        candidateStats.push_back(stats);
+        patches.push_back(rewriter.textPatch);
+        cursors.push_back(rewriter.getCursor());
+        checkPoints.push_back(rewriter.checkPoints);
+    }
+
+    size_t committedIdx = svBugpoint->testSpeculatively(candidates, candidateStats, patches);
+    if (committedIdx == candidates.size()) {
+        rewriter.setCursor(start);
+        if (candidates.empty() || sizes.back() == 1) {
+            return 0;  // the culprit is the first node
+        }
+        return rewriteBisectFailed(rewriter, tree, stageName, passIdx, svBugpoint, sizes.back());
+    }
+
+    tree = candidates[committedIdx];
+    rewriter.checkPoints = checkPoints[committedIdx];
+    rewriter.setCursor(cursors[committedIdx]);
+    for (auto& checkPoint : rewriter.checkPoints) {
+        rewriter.recordCommit(checkPoint.rewritePoint);
+    }
+    rewriter.moveToPoint(rewriter.checkPoints.back().sibling);
+    size_t rewritten = rewriter.checkPoints.size();
+    if (rewritten < sizes[committedIdx]) {
+        return rewritten;  // traversal ended
+    }
+    // The culprit is in remaining nodes of the last failed half
+    size_t failedSize = committedIdx == 0 ? n : sizes[committedIdx - 1];
+    return rewritten + rewriteBisectFailed(rewriter, tree, stageName, passIdx, svBugpoint,
+                                           failedSize - rewritten);
+}
+
 template <typename TDerived>
 size_t rewriteBisect(TDerived& rewriter,
                      std::shared_ptr<SyntaxTree>& tree,
@@ -294,11 +602,22 @@ size_t rewriteBisect(TDerived& rewriter,
                      std::string passIdx,
                      SvBugpoint* svBugpoint,
                      size_t n,
-                     bool topMostCall = true) {
+                     bool topMostCall = true,
+                     BatchSizeController* batchSize = nullptr) {
+    // batchSize (if given) is informed about outcome of the whole batch
     RewriteResult result = rewrite(rewriter, tree, stageName, passIdx, svBugpoint, n);
 
     if (result == RewriteResult::PASS) {
+        for (auto& checkPoint : rewriter.checkPoints) {
+            rewriter.recordCommit(checkPoint.rewritePoint);
+        }
         rewriter.moveToPoint(rewriter.checkPoints.back().sibling);
+        if (topMostCall) {
+            rewriter.applyCommits();
+        }
+        if (batchSize) {
+            batchSize->recordSuccess(rewriter.checkPoints.size());
+        }
         return rewriter.checkPoints.size();
     } else if (result == RewriteResult::FAIL) {
         rewriter.retry();
@@ -308,7 +627,12 @@ size_t rewriteBisect(TDerived& rewriter,
                                                    checkPoints.size());
             // The culprit sits after the last succesfully rewritten node.
             // Next attempts should start from its children
+            rewriter.applyCommits();
+            rewriter.recordFailure(checkPoints[rewritten].rewritePoint);
             rewriter.moveToPoint(checkPoints[rewritten].childOrSibling);
+            if (batchSize) {
+                batchSize->recordFailure(rewritten);
+            }
             return rewritten;
         } else {
             return rewriteBisectFailed(rewriter, tree, stageName, passIdx, svBugpoint,
@@ -320,6 +644,54 @@ size_t rewriteBisect(TDerived& rewriter,
     }
 }
 
+template <typename TDerived>
+size_t rewriteSpeculatively(TDerived& rewriter,
+                            std::shared_ptr<SyntaxTree>& tree,
+                            std::string stageName,
+                            std::string passIdx,
+                            SvBugpoint* svBugpoint,
+                            BatchSizeController& batchSize) {
+    // Check up to svBugpoint->jobs single-node rewrites at once.
+    // Each of them is prepared as if previous one failed (i.e. starting from point
+    // that rewriteBisect would move to after rollback), so committing the first passing one
+    // gives the same result as checking them one-by-one.
+    using Cursor = typename IncrementalRewriter<TDerived>::Cursor;
+    std::vector<std::shared_ptr<SyntaxTree>> candidates;
+    std::vector<AttemptStats> candidateStats;
+    std::vector<Cursor> cursors;
+    std::vector<CheckPoint> checkPoints;
+    std::vector<std::optional<TextPatch>> patches;
+    while ((int)candidates.size() < svBugpoint->jobs && !rewriter.traversalDone) {
+        auto stats = AttemptStats(passIdx, stageName, svBugpoint);
+        auto tmpTree = rewriter.transform(tree, stats, 1);
+        if (rewriter.traversalDone && tmpTree == tree) {
+            break;  // no change - no reason to test
+        }
+        candidates.push_back(tmpTree);
+        candidateStats.push_back(stats);
+        patches.push_back(rewriter.textPatch);
+        cursors.push_back(rewriter.getCursor());
+        checkPoints.push_back(rewriter.checkPoints.back());
+        rewriter.moveToPoint(checkPoints.back().childOrSibling);
+    }
+
+    size_t committedIdx = svBugpoint->testSpeculatively(candidates, candidateStats, patches);
+    for (size_t i = 0; i < std::min(committedIdx, candidates.size()); i++) {
+        batchSize.recordFailure(0);
+        rewriter.recordFailure(checkPoints[i].rewritePoint);
+    }
+    if (committedIdx == candidates.size()) {
+        return 0;  // rewriter is already past all failed attempts
+    }
+    batchSize.recordSuccess(1);
+    rewriter.recordCommit(checkPoints[committedIdx].rewritePoint);
+    rewriter.applyCommits();
+    tree = candidates[committedIdx];
+    rewriter.setCursor(cursors[committedIdx]);
+    rewriter.moveToPoint(checkPoints[committedIdx].sibling);
+    return 1;
+}
+
 template <typename TDerived>
 bool rewriteLoop(std::shared_ptr<SyntaxTree>& tree,
                  std::string stageName,
@@ -329,17 +701,76 @@ bool rewriteLoop(std::shared_ptr<SyntaxTree>& tree,
     // Keep the concrete type here: derived rewriters can refresh state before delegating to the
     // base transform().
     TDerived rewriter;
+    rewriter.svBugpoint = svBugpoint;
+    rewriter.stageName = stageName;
+    rewriter.failureMemo = svBugpoint->getFailureMemo();
+    rewriter.skipKnownFailures = svBugpoint->getSkipKnownFailures();
+    if (svBugpoint->candidateOrder == SvBugpoint::CandidateOrder::Size) {
+        rewriter.sizeOrdered = true;
+        if (auto candidates = svBugpoint->takeEnumeratedCandidates(stageName)) {
+            rewriter.queue = std::move(*candidates);
+            rewriter.remaining = rewriter.queue.size();
+            rewriter.collected = true;
+        }
+        return rewriteQueue(rewriter, tree, stageName, passIdx, svBugpoint);
+    }
     bool committed = false;
-    size_t rewriteLimit = svBugpoint->n_at_once;
+    auto& batchSize = svBugpoint->getBatchSize(stageName);
     while (!rewriter.traversalDone) {
+        size_t rewriteLimit = batchSize.get();
         size_t rewritten =
-            rewriteBisect(rewriter, tree, stageName, passIdx, svBugpoint, rewriteLimit);
-        if (rewritten >= 1) {
-            rewriteLimit = svBugpoint->n_at_once;
-            committed = true;
-        } else {
-            rewriteLimit = 1;
-        }
+            rewriteLimit == 1 && svBugpoint->jobs > 1
+                ? rewriteSpeculatively(rewriter, tree, stageName, passIdx, svBugpoint, batchSize)
+                : rewriteBisect(rewriter, tree, stageName, passIdx, svBugpoint, rewriteLimit, true,
+                                &batchSize);
+        committed |= rewritten >= 1;
     }
     return committed;
 }
+
+template <typename TDerived>
+class RewriterCandidateProducer : public CandidateProducer {
+   public:
+    RewriterCandidateProducer(const std::string& stageName,
+                              SvBugpoint* svBugpoint,
+                              std::shared_ptr<TreeIndex> treeIndex) {
+        rewriter.svBugpoint = svBugpoint;
+        rewriter.stageName = stageName;
+        rewriter.failureMemo = svBugpoint->getFailureMemo();
+        rewriter.skipKnownFailures = svBugpoint->getSkipKnownFailures();
+        rewriter.treeIndex = treeIndex;
+        rewriter.collecting = true;
+    }
+
+    bool collect(const SyntaxNode& node, bool isNodeRemovable) override {
+        Dispatch dispatch{rewriter};
+        node.visit(dispatch, isNodeRemovable);
+        return dispatch.visitChildren;
+    }
+
+    std::vector<RewriteCandidate> takeCandidates() override {
+        std::sort(rewriter.queue.begin(), rewriter.queue.end());
+        return std::move(rewriter.queue);
+    }
+
+   private:
+    // calls handler of node's concrete type
+    struct Dispatch {
+        TDerived& rewriter;
+        bool visitChildren = true;
+        template <typename T>
+        void visit(const T& node, bool isNodeRemovable) {
+            visitChildren = rewriter.collectNode(node, isNodeRemovable);
+        }
+    };
+
+    TDerived rewriter;
+};
+
+template <typename TDerived>
+std::unique_ptr<CandidateProducer> makeCandidateProducer(const std::string& stageName,
+                                                         SvBugpoint* svBugpoint,
+                                                         std::shared_ptr<TreeIndex> treeIndex) {
+    return std::make_unique<RewriterCandidateProducer<TDerived>>(stageName, svBugpoint,
+                                                                 treeIndex);
+}
@@ -1,6 +1,8 @@
 // SPDX-License-Identifier: Apache-2.0
 #include <slang/syntax/SyntaxTree.h>
+#include "CandidateEnumerator.hpp"
 #include "SvBugpoint.hpp"
+#include "TreeIndex.hpp"
 
 using namespace slang::syntax;
 
@@ -28,3 +30,11 @@ bool rewriteLoop(std::shared_ptr<SyntaxTree>& tree,
                  std::string stageName,
                  std::string passIdx,
                  SvBugpoint* svBugpoint);
+
+// Rewriter of given type that only collects candidates, for enumerating candidates of all stages
+// in single traversal. Not available for ExternInliner, whose handlers depend on state
+// computed for the whole tree.
+template <typename T>
+std::unique_ptr<CandidateProducer> makeCandidateProducer(const std::string& stageName,
+                                                         SvBugpoint* svBugpoint,
+                                                         std::shared_ptr<TreeIndex> treeIndex);
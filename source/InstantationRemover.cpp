@@ -13,3 +13,7 @@ template bool rewriteLoop<InstantationRemover>(std::shared_ptr<SyntaxTree>& tree
                                                std::string stageName,
                                                std::string passIdx,
                                                SvBugpoint* svBugpoint);
+template std::unique_ptr<CandidateProducer> makeCandidateProducer<InstantationRemover>(
+    const std::string& stageName,
+    SvBugpoint* svBugpoint,
+    std::shared_ptr<TreeIndex> treeIndex);
@@ -55,3 +55,7 @@ template bool rewriteLoop<MemberRemover>(std::shared_ptr<SyntaxTree>& tree,
                                          std::string stageName,
                                          std::string passIdx,
                                          SvBugpoint* svBugpoint);
+template std::unique_ptr<CandidateProducer> makeCandidateProducer<MemberRemover>(
+    const std::string& stageName,
+    SvBugpoint* svBugpoint,
+    std::shared_ptr<TreeIndex> treeIndex);
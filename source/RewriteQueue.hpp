@@ -0,0 +1,166 @@
+// SPDX-License-Identifier: Apache-2.0
+#pragma once
+#include <slang/syntax/SyntaxTree.h>
+#include <algorithm>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+#include "SvBugpoint.hpp"
+#include "TextSplice.hpp"
+#include "Utils.hpp"
+
+using namespace slang::syntax;
+
+// Drive rewriter that consumes a queue of reductions, sorted once, from the back
+// (SetRemover, or IncrementalRewriter in size order). Rewriter has to provide:
+// - transform(tree, stats, n) applying up to n next reductions at once, which sets
+//   traversalDone once the queue is exhausted,
+// - remaining: number of reductions that are yet to be tried (the queue can be rewound by
+//   setting it, e.g. to retry reductions consumed by speculative attempts),
+// - appliedSets: number of reductions applied by the last transform(), i.e. ones at
+//   [remaining, remaining+appliedSets) positions,
+// - textPatch (see IncrementalRewriter::textPatch),
+// - recordOutcome(position, n, passed), called with outcome of n reductions applied at once,
+// - optionally applyCommits(), called once outcome of the whole batch (bisected or not) is
+//   known, so that commits of a bisection don't change which reductions get skipped in it.
+template <typename TRewriter>
+size_t rewriteQueueBisectFailed(TRewriter& rewriter,
+                                std::shared_ptr<SyntaxTree>& tree,
+                                const std::string& stageName,
+                                const std::string& passIdx,
+                                SvBugpoint* svBugpoint,
+                                size_t n) {
+    // Next n reductions (starting from rewriter.remaining) are known to fail when applied at
+    // once. Like rewriteBisectFailed: commit the passing ones preceding the culprit, and return
+    // their count, leaving rewriter right after the culprit.
+    // Up to svBugpoint->jobs leading halves (n/2, n/4, ... reductions) are checked at once, each
+    // as if the previous (larger) one failed.
+    size_t rewritten = 0;
+    while (true) {
+        size_t start = rewriter.remaining;
+        if (n <= 1) {
+            auto stats = AttemptStats(passIdx, stageName, svBugpoint);
+            auto tmpTree = rewriter.transform(tree, stats, 1);
+            if (!(rewriter.traversalDone && tmpTree == tree)) {
+                // The culprit - skip it without testing
+                rewriter.recordOutcome(rewriter.remaining, start - rewriter.remaining, false);
+            }
+            return rewritten;
+        }
+
+        std::vector<std::shared_ptr<SyntaxTree>> candidates;
+        std::vector<AttemptStats> candidateStats;
+        std::vector<std::optional<TextPatch>> patches;
+        std::vector<size_t> positions;
+        std::vector<size_t> appliedSets;
+        for (size_t size = n / 2; size >= 1 && (int)candidates.size() < svBugpoint->jobs;
+             size /= 2) {
+            rewriter.remaining = start;
+            auto stats = AttemptStats(passIdx, stageName, svBugpoint);
+            auto tmpTree = rewriter.transform(tree, stats, size);
+            if (rewriter.traversalDone && tmpTree == tree) {
+                break;
+            }
+            candidates.push_back(tmpTree);
+            candidateStats.push_back(stats);
+            patches.push_back(rewriter.textPatch);
+            positions.push_back(rewriter.remaining);
+            appliedSets.push_back(stats.batch);
+        }
+        if (candidates.empty()) {
+            return rewritten;
+        }
+
+        size_t committedIdx = svBugpoint->testSpeculatively(candidates, candidateStats, patches);
+        for (size_t i = 0; i < std::min(committedIdx, candidates.size()); i++) {
+            rewriter.recordOutcome(positions[i], start - positions[i], false);
+        }
+        if (committedIdx < candidates.size()) {
+            // The culprit is in remaining reductions of the last failed half
+            rewriter.recordOutcome(positions[committedIdx], start - positions[committedIdx],
+                                   true);
+            tree = candidates[committedIdx];
+            rewriter.remaining = positions[committedIdx];
+            rewritten += appliedSets[committedIdx];
+            size_t failed = committedIdx == 0 ? n : appliedSets[committedIdx - 1];
+            n = failed - std::min(failed, appliedSets[committedIdx]);
+        } else {
+            // The culprit is in the smallest half
+            rewriter.remaining = start;
+            n = appliedSets.back();
+        }
+    }
+}
+
+template <typename TRewriter>
+void applyQueueCommits(TRewriter& rewriter) {
+    if constexpr (requires { rewriter.applyCommits(); }) {
+        rewriter.applyCommits();
+    }
+}
+
+template <typename TRewriter>
+bool rewriteQueue(TRewriter& rewriter,
+                  std::shared_ptr<SyntaxTree>& tree,
+                  const std::string& stageName,
+                  const std::string& passIdx,
+                  SvBugpoint* svBugpoint) {
+    bool committed = false;
+    rewriter.traversalDone = false;
+    auto& batchSize = svBugpoint->getBatchSize(stageName);
+
+    while (!rewriter.traversalDone) {
+        // Either try a batch of reductions at once (bisecting it on failure, like rewriteBisect),
+        // or prepare up to `jobs` single-reduction attempts, each as if all previous ones failed.
+        // Only the first passing one gets committed, so the rewriter has to be rewound to the
+        // position right after it.
+        size_t sets = batchSize.get();
+        int maxCandidates = sets > 1 ? 1 : svBugpoint->jobs;
+        std::vector<std::shared_ptr<SyntaxTree>> candidates;
+        std::vector<AttemptStats> candidateStats;
+        std::vector<size_t> positions;
+        std::vector<size_t> appliedSets;
+        std::vector<std::optional<TextPatch>> patches;
+        while ((int)candidates.size() < maxCandidates && !rewriter.traversalDone) {
+            auto stats = AttemptStats(passIdx, stageName, svBugpoint);
+            auto tmpTree = rewriter.transform(tree, stats, sets);
+            if (rewriter.traversalDone && tmpTree == tree) {
+                break;  // no change - no reason to test
+            }
+            candidates.push_back(tmpTree);
+            candidateStats.push_back(stats);
+            positions.push_back(rewriter.remaining);
+            appliedSets.push_back(rewriter.appliedSets);
+            patches.push_back(rewriter.textPatch);
+        }
+
+        size_t committedIdx = svBugpoint->testSpeculatively(candidates, candidateStats, patches);
+        if (committedIdx == 1 && candidates.size() == 1 && candidateStats[0].batch > 1) {
+            // Find the culprit of failed batch by bisection
+            rewriter.recordOutcome(positions[0], appliedSets[0], false);
+            rewriter.remaining = positions[0] + appliedSets[0];
+            size_t rewritten = rewriteQueueBisectFailed(rewriter, tree, stageName, passIdx,
+                                                        svBugpoint, candidateStats[0].batch);
+            applyQueueCommits(rewriter);
+            batchSize.recordFailure(rewritten);
+            committed |= rewritten > 0;
+            rewriter.traversalDone = rewriter.remaining == 0;
+            continue;
+        }
+        for (size_t i = 0; i < std::min(committedIdx, candidates.size()); i++) {
+            batchSize.recordFailure(0);
+            rewriter.recordOutcome(positions[i], appliedSets[i], false);
+        }
+        if (committedIdx < candidates.size()) {
+            batchSize.recordSuccess(appliedSets[committedIdx]);
+            rewriter.recordOutcome(positions[committedIdx], appliedSets[committedIdx], true);
+            applyQueueCommits(rewriter);
+            tree = candidates[committedIdx];
+            rewriter.remaining = positions[committedIdx];
+            rewriter.traversalDone = rewriter.remaining == 0;
+            committed = true;
+        }
+    }
+    return committed;
+}
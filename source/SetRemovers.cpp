@@ -1,13 +1,16 @@
 // SPDX-License-Identifier: Apache-2.0
 #include "SetRemovers.hpp"
 #include <slang/ast/ASTVisitor.h>
+#include <slang/syntax/AllSyntax.h>
+#include <algorithm>
+#include <concepts>
+#include <optional>
+#include <span>
+#include <string_view>
 #include <unordered_map>
 
 template <typename TNodeMapper>
-SetRemover makeSetRemover(std::shared_ptr<SyntaxTree> tree) {
-    Compilation compilation;
-    compilation.addSyntaxTree(tree);
-    compilation.getAllDiagnostics();
+SetRemover makeSetRemover(Compilation& compilation) {
     TNodeMapper mapper;
     compilation.getRoot().visit(mapper);
     return SetRemover(std::move(mapper.removals));
@@ -136,47 +139,44 @@ class FunctionArgMapper final : public ASTVisitor<FunctionArgMapper, true, true,
     }
 };
 
-SetRemover makeFunctionArgRemover(std::shared_ptr<SyntaxTree> tree) {
-    return makeSetRemover<FunctionArgMapper>(tree);
+SetRemover makeFunctionArgRemover(Compilation& compilation) {
+    return makeSetRemover<FunctionArgMapper>(compilation);
 }
 
 class PortMapper final : public ASTVisitor<PortMapper, true, true, true> {
     // Builds vector that maps the definitions  and usages of ports
    public:
-    class FindConnectionSyntax : public SyntaxVisitor<FindConnectionSyntax> {
+    class ConnectionIndex : public SyntaxVisitor<ConnectionIndex> {
         // PortConnection symbol does not have getSyntax() or sourceRange() methods.
-        // This visitor finds sourceRange by locating PortConnectionSyntax that contains the same
-        // expression as symbol
-        enum {
-            WAIT_FOR_EXPR,
-            REGISTER_PORT_CONN,
-            END,
-        } state;
-
-        SourceRange exprLoc;
+        // This visitor maps source ranges of expressions to PortConnectionSyntax that contains
+        // them, so connection can be found by the range of its expression.
+        // Built once per instance, as searching instance syntax for each connection separately
+        // is quadratic in the number of ports.
+        const PortConnectionSyntax* currentConn = nullptr;
 
        public:
-        SourceRange connLoc;
-        FindConnectionSyntax(const PortConnection* symbol)
-            : connLoc(SourceRange::NoLocation), state(WAIT_FOR_EXPR) {
-            auto expr = symbol ? symbol->getExpression() : nullptr;
-            exprLoc = expr ? expr->sourceRange : SourceRange::NoLocation;
-            if (exprLoc == SourceRange::NoLocation) {
-                state = END;
-            }
-        }
+        std::unordered_map<SourceRange, SourceRange> connByExpr;
 
         void handle(const PortConnectionSyntax& t) {
+            auto outerConn = currentConn;
+            currentConn = &t;
             visitDefault(t);
-            if (state == REGISTER_PORT_CONN) {
-                state = END;
-                connLoc = t.sourceRange();
-            }
+            currentConn = outerConn;
         }
         void handle(const ExpressionSyntax& t) {
-            if (state == WAIT_FOR_EXPR && t.sourceRange() == exprLoc) {
-                state = REGISTER_PORT_CONN;
+            if (currentConn) {
+                // keep the first one in preorder
+                connByExpr.emplace(t.sourceRange(), currentConn->sourceRange());
+            }
+        }
+
+        SourceRange find(const PortConnection* symbol) const {
+            auto expr = symbol ? symbol->getExpression() : nullptr;
+            if (!expr || expr->sourceRange == SourceRange::NoLocation) {
+                return SourceRange::NoLocation;
             }
+            auto it = connByExpr.find(expr->sourceRange);
+            return it != connByExpr.end() ? it->second : SourceRange::NoLocation;
         }
     };
 
@@ -191,19 +191,17 @@ class PortMapper final : public ASTVisitor<PortMapper, true, true, true> {
     std::vector<SetRemover::RemovalSet> removals;
     void handle(const InstanceSymbol& instance) {
         std::unordered_set<SourceRange> connectedPortDefs;
+        ConnectionIndex connections;
+        if (instance.getSyntax()) {
+            instance.getSyntax()->visit(connections);
+        }
         for (auto conn : instance.getPortConnections()) {
             if (!conn) {
                 continue;
             }
 
             SourceRange defLocation = getPortDefLoc(&conn->port);
-            SourceRange useLocation = SourceRange::NoLocation;
-
-            if (instance.getSyntax()) {
-                FindConnectionSyntax finder(conn);
-                instance.getSyntax()->visit(finder);
-                useLocation = finder.connLoc;
-            }
+            SourceRange useLocation = connections.find(conn);
 
             if (defLocation != SourceRange::NoLocation || useLocation != SourceRange::NoLocation) {
                 removals.push_back({defLocation, useLocation});
@@ -224,8 +222,8 @@ class PortMapper final : public ASTVisitor<PortMapper, true, true, true> {
     }
 };
 
-SetRemover makePortsRemover(std::shared_ptr<SyntaxTree> tree) {
-    return makeSetRemover<PortMapper>(tree);
+SetRemover makePortsRemover(Compilation& compilation) {
+    return makeSetRemover<PortMapper>(compilation);
 }
 
 class StructFieldMapper final : public ASTVisitor<StructFieldMapper, true, true, true> {
@@ -252,6 +250,454 @@ class StructFieldMapper final : public ASTVisitor<StructFieldMapper, true, true,
     }
 };
 
-SetRemover makeStructFieldRemover(std::shared_ptr<SyntaxTree> tree) {
-    return makeSetRemover<StructFieldMapper>(tree);
+SetRemover makeStructFieldRemover(Compilation& compilation) {
+    return makeSetRemover<StructFieldMapper>(compilation);
+}
+
+class IdentifierCollector : public SyntaxVisitor<IdentifierCollector> {
+    // Collects all identifiers used in visited nodes
+   public:
+    std::unordered_set<std::string_view> names;
+
+    void visitToken(parsing::Token tok) {
+        if (tok.kind == parsing::TokenKind::Identifier) {
+            names.insert(tok.valueText());
+        }
+    }
+};
+
+class IdentifierLocator : public SyntaxVisitor<IdentifierLocator> {
+    // Collects locations of identifiers with names that are keys of `locations`
+   public:
+    std::unordered_map<std::string_view, std::vector<SourceLocation>> locations;
+
+    void visitToken(parsing::Token tok) {
+        if (tok.kind == parsing::TokenKind::Identifier) {
+            if (auto it = locations.find(tok.valueText()); it != locations.end()) {
+                it->second.push_back(tok.location());
+            }
+        }
+    }
+};
+
+class UnreachableDeclMapper final : public ASTVisitor<UnreachableDeclMapper, true, true, true> {
+    // Finds top-level declarations that can't be reached from the elaborated design:
+    // definitions (modules, interfaces, programs) that are neither instantiated in elaborated
+    // hierarchy of a top nor top, as well as packages, classes, functions and tasks, whose name
+    // isn't used by any reachable code (e.g. definition instantiated only in not taken generate
+    // branch of a reachable one is kept).
+    // Slang makes a top of each definition that isn't instantiated anywhere, which includes dead
+    // ones next to the actual top. Unless tops are given explicitly, all of them are removed
+    // (so the actual one is kept only after bisection), but names they use are kept.
+    // Names are compared regardless of scoping, so it errs on the side of keeping declarations.
+   public:
+    std::unordered_set<const SyntaxNode*> instantiated;
+    // definitions of tops that were not given explicitly
+    std::unordered_set<const SyntaxNode*> implicitTops;
+    std::span<const std::string> explicitTops;
+
+    void handle(const InstanceSymbol& instance) {
+        if (auto syntax = instance.getDefinition().getSyntax()) {
+            instantiated.insert(syntax);
+        }
+        visitDefault(instance);
+    }
+
+    void visitTops(const RootSymbol& root) {
+        for (auto instance : root.topInstances) {
+            if (explicitTops.empty()) {
+                if (auto syntax = instance->getDefinition().getSyntax()) {
+                    implicitTops.insert(syntax);
+                }
+                instance->body.visit(*this);  // doesn't make it instantiated
+            } else if (isExplicitTop(instance->name)) {
+                instance->visit(*this);
+            }
+        }
+    }
+
+    std::vector<SetRemover::RemovalSet> findUnreachable(const CompilationUnitSyntax& root,
+                                                         IdentifierCollector& usedNames) {
+        // usedNames initially holds names used outside of given tree
+        std::vector<std::pair<const MemberSyntax*, std::string_view>> unused;
+        std::vector<const SyntaxNode*> reachable;
+        for (auto member : root.members) {
+            switch (member->kind) {
+                case SyntaxKind::ModuleDeclaration:
+                case SyntaxKind::InterfaceDeclaration:
+                case SyntaxKind::ProgramDeclaration: {
+                    auto name = member->as<ModuleDeclarationSyntax>().header->name.valueText();
+                    if (instantiated.contains(member) || isExplicitTop(name)) {
+                        reachable.push_back(member);
+                    } else {
+                        unused.push_back({member, name});
+                    }
+                    if (implicitTops.contains(member)) {
+                        IdentifierCollector topNames;
+                        member->visit(topNames);
+                        topNames.names.erase(name);
+                        usedNames.names.insert(topNames.names.begin(), topNames.names.end());
+                    }
+                    break;
+                }
+                case SyntaxKind::PackageDeclaration:
+                    unused.push_back(
+                        {member, member->as<ModuleDeclarationSyntax>().header->name.valueText()});
+                    break;
+                case SyntaxKind::ClassDeclaration:
+                    unused.push_back(
+                        {member, member->as<ClassDeclarationSyntax>().name.valueText()});
+                    break;
+                case SyntaxKind::FunctionDeclaration:
+                case SyntaxKind::TaskDeclaration: {
+                    // out-of-block methods have scoped names, and belong to their class
+                    auto& name = *member->as<FunctionDeclarationSyntax>().prototype->name;
+                    if (name.kind == SyntaxKind::IdentifierName) {
+                        unused.push_back(
+                            {member, name.as<IdentifierNameSyntax>().identifier.valueText()});
+                    } else {
+                        reachable.push_back(member);
+                    }
+                    break;
+                }
+                default:
+                    reachable.push_back(member);
+                    break;
+            }
+        }
+
+        // Declarations become reachable once their name is used by reachable code (or other files)
+        while (true) {
+            std::erase_if(unused, [&](auto& decl) {
+                if (usedNames.names.contains(decl.second)) {
+                    reachable.push_back(decl.first);
+                    return true;
+                }
+                return false;
+            });
+            if (reachable.empty()) {
+                break;
+            }
+            for (auto node : reachable) {
+                node->visit(usedNames);
+            }
+            reachable.clear();
+        }
+        std::vector<SetRemover::RemovalSet> removals;
+        for (auto& decl : unused) {
+            removals.push_back({decl.first->sourceRange()});
+        }
+        return removals;
+    }
+
+   private:
+    bool isExplicitTop(std::string_view name) const {
+        return std::find(explicitTops.begin(), explicitTops.end(), name) != explicitTops.end();
+    }
+};
+
+SetRemover makeUnreachableDeclRemover(Compilation& compilation,
+                                      std::span<const std::shared_ptr<SyntaxTree>> otherTrees,
+                                      std::span<const std::string> topModules) {
+    UnreachableDeclMapper mapper;
+    mapper.explicitTops = topModules;
+    mapper.visitTops(compilation.getRoot());
+    IdentifierCollector usedNames;
+    for (auto& tree : otherTrees) {
+        tree->root().visit(usedNames);
+    }
+    std::vector<SetRemover::RemovalSet> removals;
+    for (auto& tree : compilation.getSyntaxTrees()) {
+        if (tree->root().kind == SyntaxKind::CompilationUnit) {
+            auto treeRemovals =
+                mapper.findUnreachable(tree->root().as<CompilationUnitSyntax>(), usedNames);
+            removals.insert(removals.end(), treeRemovals.begin(), treeRemovals.end());
+        }
+    }
+    return SetRemover(std::move(removals));
+}
+
+class CascadeMapper final : public ASTVisitor<CascadeMapper, true, true, true> {
+    // Builds sets of declarations (of variables, nets, parameters and typedefs) together with
+    // all statements, continuous assignments, port connections, parameter assignments and
+    // declarations that refer to them, so the declaration can be removed without leaving
+    // dangling references behind. Uses of declarations removed that way (e.g. of `b` in
+    // `logic b = a;`) are added to the set too.
+    // Each module is elaborated once per instance, so declarations are identified by ranges.
+    // Not all references are visited in AST (e.g. types in casts, or in subroutine prototypes),
+    // so declarations whose name appears outside of their uses (within the module they are
+    // local to) are left out.
+   public:
+    void handle(const NamedValueExpression& expr) {
+        switch (expr.symbol.kind) {
+            case SymbolKind::Variable:
+            case SymbolKind::Net:
+            case SymbolKind::Parameter:
+                addUse(getDeclarationNode(expr.symbol), expr.symbol.name, expr.syntax);
+                break;
+            default:
+                break;
+        }
+        visitDefault(expr);
+    }
+
+    template <typename T>
+        requires std::derived_from<T, ValueSymbol>
+    void handle(const T& symbol) {
+        auto& type = symbol.getType();
+        if (type.isAlias() && type.getSyntax()) {
+            // uses of the typedef are declarations of given type
+            addUse(type.getSyntax(), type.name, getDeclarationNode(symbol));
+        }
+        visitDefault(symbol);
+    }
+
+    void handle(const InstanceSymbol& instance) {
+        for (auto conn : instance.getPortConnections()) {
+            if (auto expr = conn ? conn->getExpression() : nullptr) {
+                expr->visit(*this);
+            }
+        }
+        visitDefault(instance);
+    }
+
+    void markUnresolvedUses(std::span<const std::shared_ptr<SyntaxTree>> trees) {
+        // Names are compared regardless of scoping, so it errs on the side of keeping
+        // declarations
+        IdentifierLocator locator;
+        for (auto& [declaration, name] : declarationNames) {
+            locator.locations[name.name];
+        }
+        for (auto& tree : trees) {
+            tree->root().visit(locator);
+        }
+        for (auto& [declaration, name] : declarationNames) {
+            if (incomplete.contains(declaration)) {
+                continue;
+            }
+            auto& uses = usesByDeclaration[declaration];
+            for (auto location : locator.locations[name.name]) {
+                if (name.visibility != SourceRange::NoLocation &&
+                    !contains(name.visibility, location)) {
+                    continue;
+                }
+                if (!contains(declaration, location) &&
+                    std::none_of(uses.begin(), uses.end(),
+                                 [&](SourceRange use) { return contains(use, location); })) {
+                    incomplete.insert(declaration);
+                    break;
+                }
+            }
+        }
+    }
+
+    std::vector<SetRemover::RemovalSet> getRemovals() {
+        std::vector<std::pair<SourceRange, SetRemover::RemovalSet>> sets;
+        for (auto& [declaration, uses] : usesByDeclaration) {
+            auto set = getClosedSet(declaration);
+            if (!set) {
+                continue;
+            }
+            removeNested(*set);
+            sets.push_back({declaration, std::move(*set)});
+        }
+        // order of declarations in the source, regardless of hashing
+        std::sort(sets.begin(), sets.end(),
+                  [](auto& a, auto& b) { return a.first.start() < b.first.start(); });
+        std::vector<SetRemover::RemovalSet> removals;
+        for (auto& [declaration, set] : sets) {
+            removals.push_back(std::move(set));
+        }
+        return removals;
+    }
+
+   private:
+    std::unordered_map<SourceRange, std::unordered_set<SourceRange>> usesByDeclaration;
+    struct DeclarationName {
+        std::string_view name;
+        // module the declaration is local to, NoLocation if it is visible anywhere
+        SourceRange visibility;
+    };
+    std::unordered_map<SourceRange, DeclarationName> declarationNames;
+    // declarations with a use that can't be removed
+    std::unordered_set<SourceRange> incomplete;
+    // declarations inside of each node that can be a use (see getUseNode())
+    std::unordered_map<SourceRange, std::vector<SourceRange>> declarationsWithin;
+
+    std::optional<SetRemover::RemovalSet> getClosedSet(SourceRange declaration) {
+        // Declaration with its uses, and uses of declarations that are removed along with them.
+        // Nothing if any of these declarations has a use that can't be removed.
+        SetRemover::RemovalSet set;
+        std::vector<SourceRange> pending{declaration};
+        std::unordered_set<SourceRange> visited{declaration};
+        while (!pending.empty()) {
+            auto current = pending.back();
+            pending.pop_back();
+            if (incomplete.contains(current)) {
+                return std::nullopt;
+            }
+            set.push_back(current);
+            auto uses = usesByDeclaration.find(current);
+            if (uses == usesByDeclaration.end()) {
+                continue;
+            }
+            for (auto use : uses->second) {
+                set.push_back(use);
+                auto nested = declarationsWithin.find(use);
+                if (nested == declarationsWithin.end()) {
+                    continue;
+                }
+                for (auto nestedDeclaration : nested->second) {
+                    if (visited.insert(nestedDeclaration).second) {
+                        pending.push_back(nestedDeclaration);
+                    }
+                }
+            }
+        }
+        return set;
+    }
+
+    void addUse(const SyntaxNode* declaration,
+                std::string_view name,
+                const SyntaxNode* useSyntax) {
+        if (!declaration || declaration->sourceRange() == SourceRange::NoLocation) {
+            return;
+        }
+        bool inserted = declarationNames
+                            .try_emplace(declaration->sourceRange(),
+                                         DeclarationName{name, getVisibility(declaration)})
+                            .second;
+        if (inserted) {
+            for (auto node = getUseNode(declaration); node; node = getUseNode(node->parent)) {
+                declarationsWithin[node->sourceRange()].push_back(declaration->sourceRange());
+            }
+        }
+        auto useNode = getUseNode(useSyntax);
+        if (!useNode) {
+            incomplete.insert(declaration->sourceRange());
+            return;
+        }
+        usesByDeclaration[declaration->sourceRange()].insert(useNode->sourceRange());
+    }
+
+    static const SyntaxNode* getDeclarationNode(const Symbol& symbol) {
+        // Node that removes the declaration of symbol, without removing other ones declared
+        // along with it. Null for declarations of other kinds (e.g. ports, loop variables).
+        auto syntax = symbol.getSyntax();
+        if (!syntax || syntax->kind != SyntaxKind::Declarator || !syntax->parent) {
+            return nullptr;
+        }
+        auto parent = syntax->parent;
+        switch (parent->kind) {
+            case SyntaxKind::DataDeclaration:
+                return parent->as<DataDeclarationSyntax>().declarators.size() == 1 ? parent
+                                                                                    : syntax;
+            case SyntaxKind::NetDeclaration:
+                return parent->as<NetDeclarationSyntax>().declarators.size() == 1 ? parent
+                                                                                   : syntax;
+            case SyntaxKind::ParameterDeclaration:
+                if (parent->as<ParameterDeclarationSyntax>().declarators.size() > 1) {
+                    return syntax;
+                }
+                if (parent->parent &&
+                    parent->parent->kind == SyntaxKind::ParameterDeclarationStatement) {
+                    return parent->parent;
+                }
+                return parent;
+            default:
+                return nullptr;
+        }
+    }
+
+    static const SyntaxNode* getUseNode(const SyntaxNode* syntax) {
+        // The nearest enclosing node that can be removed along with the declaration.
+        // Required children (e.g. statement of a procedural block) can't be removed on their
+        // own, so their parents are removed instead.
+        bool found = false;
+        for (auto node = syntax; node; node = node->parent) {
+            switch (node->kind) {
+                case SyntaxKind::ContinuousAssign:
+                case SyntaxKind::NamedPortConnection:
+                case SyntaxKind::OrderedPortConnection:
+                case SyntaxKind::NamedParamAssignment:
+                case SyntaxKind::OrderedParamAssignment:
+                case SyntaxKind::DataDeclaration:
+                case SyntaxKind::NetDeclaration:
+                case SyntaxKind::ParameterDeclarationStatement:
+                    found = true;
+                    break;
+                case SyntaxKind::ModuleDeclaration:
+                case SyntaxKind::InterfaceDeclaration:
+                case SyntaxKind::ProgramDeclaration:
+                case SyntaxKind::PackageDeclaration:
+                case SyntaxKind::ClassDeclaration:
+                case SyntaxKind::FunctionDeclaration:
+                case SyntaxKind::TaskDeclaration:
+                    return nullptr;
+                default:
+                    found |= StatementSyntax::isKind(node->kind);
+                    break;
+            }
+            if (found && !isRequiredChild(*node)) {
+                return node;
+            }
+        }
+        return nullptr;
+    }
+
+    static bool isRequiredChild(const SyntaxNode& node) {
+        auto parent = node.parent;
+        if (!parent) {
+            return false;
+        }
+        for (size_t i = 0; i < parent->getChildCount(); i++) {
+            if (parent->childNode(i) == &node) {
+                return !parent->isChildOptional(i);
+            }
+        }
+        return false;
+    }
+
+    static SourceRange getVisibility(const SyntaxNode* declaration) {
+        auto member = declaration;
+        while (member->parent && member->parent->kind != SyntaxKind::CompilationUnit) {
+            member = member->parent;
+        }
+        switch (member->kind) {
+            case SyntaxKind::ModuleDeclaration:
+            case SyntaxKind::InterfaceDeclaration:
+            case SyntaxKind::ProgramDeclaration:
+                return member->sourceRange();
+            default:
+                return SourceRange::NoLocation;  // e.g. declared in a package
+        }
+    }
+
+    static bool contains(SourceRange range, SourceLocation location) {
+        return range.start().buffer() == location.buffer() && !(location < range.start()) &&
+               location < range.end();
+    }
+
+    static void removeNested(SetRemover::RemovalSet& set) {
+        // Nodes inside other nodes of the set wouldn't be visited once the outer one is
+        // removed, so the set couldn't be applied in full
+        std::sort(set.begin(), set.end(), [](auto& a, auto& b) {
+            return a.start() != b.start() ? a.start() < b.start() : a.end() > b.end();
+        });
+        SetRemover::RemovalSet outer;
+        for (auto range : set) {
+            if (outer.empty() || outer.back().end().buffer() != range.start().buffer() ||
+                outer.back().end() < range.end()) {
+                outer.push_back(range);
+            }
+        }
+        set = std::move(outer);
+    }
+};
+
+SetRemover makeCascadeRemover(Compilation& compilation) {
+    CascadeMapper mapper;
+    compilation.getRoot().visit(mapper);
+    mapper.markUnresolvedUses(compilation.getSyntaxTrees());
+    return SetRemover(mapper.getRemovals());
 }
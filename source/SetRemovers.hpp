@@ -1,6 +1,14 @@
 // SPDX-License-Identifier: Apache-2.0
 #pragma once
+#include <slang/ast/Compilation.h>
 #include <slang/syntax/SyntaxVisitor.h>
+#include <algorithm>
+#include <span>
+#include <string>
+#include <vector>
+#include "FailureMemo.hpp"
+#include "TextSplice.hpp"
+#include "TreeIndex.hpp"
 #include "Utils.hpp"
 
 class SetRemover : public SyntaxRewriter<SetRemover> {
@@ -9,42 +17,142 @@ class SetRemover : public SyntaxRewriter<SetRemover> {
     using RemovalSet = std::vector<SourceRange>;
 
     std::vector<RemovalSet> removals;
+    // Sets are tried starting from the back, removals[0, remaining) are yet to be tried.
+    // It can be rewound to retry sets that were consumed by speculative attempts.
+    size_t remaining;
     std::unordered_set<SourceRange> pendingNodes;
     std::string removedTypeInfo;
+    // Number of sets merged into the last transform(), removals[remaining, remaining+appliedSets)
+    size_t appliedSets;
+    // text offsets of nodes of the tree that is being transformed
+    TreeIndex treeIndex;
+    // Edits of printed tree equivalent to removals done by the last transform()
+    // (see IncrementalRewriter::textPatch)
+    std::optional<TextPatch> textPatch;
+    bool traversalDone = false;
+    // Sets that failed on their own are recorded in failureMemo (if given), and unless
+    // skipKnownFailures is cleared, they are not tried again (see IncrementalRewriter)
+    std::string stageName;
+    FailureMemo* failureMemo = nullptr;
+    bool skipKnownFailures = false;
+    // set by commits not applied to failureMemo yet (see applyCommits())
+    bool modified = false;
 
-    SetRemover(std::vector<RemovalSet>&& removals) : removals(removals) {}
+    SetRemover(std::vector<RemovalSet>&& removals)
+        : removals(removals), remaining(this->removals.size()) {}
 
     std::shared_ptr<SyntaxTree> transform(const std::shared_ptr<SyntaxTree>& tree,
-                                          bool& traversalDone,
-                                          AttemptStats& stats) {
-        if (removals.empty()) {
+                                          AttemptStats& stats,
+                                          size_t maxSets = 1) {
+        // Remove nodes of up to maxSets sets at once
+        if (remaining == 0) {
             traversalDone = true;
             return tree;
         }
-        RemovalSet removal = removals.back();
-        removals.pop_back();
+        if (!treeIndex.isBuiltFor(tree)) {
+            treeIndex.build(tree);
+        }
         pendingNodes.clear();
         removedTypeInfo = "";
-        for (const auto& node : removal) {
-            if (node != SourceRange::NoLocation) {
-                pendingNodes.insert(std::move(node));
+        for (appliedSets = 0; appliedSets < maxSets && remaining > 0; appliedSets++) {
+            auto& set = removals[--remaining];
+            if (knownToFail(set)) {
+                continue;  // consumed as a no-op
+            }
+            for (const auto& node : set) {
+                if (node != SourceRange::NoLocation) {
+                    pendingNodes.insert(node);
+                }
             }
         }
         if (pendingNodes.empty()) {
-            return transform(tree, traversalDone, stats);
+            return transform(tree, stats, maxSets);
         }
 
+        textPatch = TextPatch{treeIndex.textSize(), {}};
         auto tree2 = SyntaxRewriter<SetRemover>::transform(tree);
 
+        if (!pendingNodes.empty() && appliedSets > 1) {
+            // Some set can't be applied in full (which would make it skipped), or its nodes are
+            // nested in ones of another set. Sort it out by applying them one by one.
+            remaining += appliedSets;
+            return transform(tree, stats, 1);
+        }
         if (!pendingNodes.empty()) {
-            return transform(tree, traversalDone, stats);
+            return transform(tree, stats, maxSets);
         }
 
         stats.typeInfo = removedTypeInfo;
-        traversalDone = removals.empty();
+        stats.batch = appliedSets;
+        traversalDone = remaining == 0;
         return tree2;
     }
 
+    // Outcome of n sets applied at once (see rewriteQueue)
+    void recordOutcome(size_t position, size_t n, bool passed) {
+        if (!failureMemo) {
+            return;
+        }
+        if (passed) {
+            modified = true;
+            return;
+        }
+        std::vector<const RemovalSet*> applied;
+        for (size_t i = position; i < position + n; i++) {
+            if (isApplicable(removals[i])) {
+                applied.push_back(&removals[i]);
+            }
+        }
+        if (applied.size() == 1) {
+            failureMemo->recordFailure(stageName, *applied[0], declarationsOf(*applied[0]));
+        }
+    }
+
+    // Forget failures once a commit is done. Like in IncrementalRewriter, it is deferred until
+    // bisection ends. Sets span many declarations, so all of them are forgotten.
+    void applyCommits() {
+        if (failureMemo && modified) {
+            failureMemo->clear();
+        }
+        modified = false;
+    }
+
+    bool knownToFail(const RemovalSet& set) const {
+        return skipKnownFailures && failureMemo &&
+               failureMemo->knownToFail(stageName, set, declarationsOf(set));
+    }
+
+    // Whether the set is removed by transform(), i.e. all its nodes are in the tree, and it is
+    // not skipped
+    bool isApplicable(const RemovalSet& set) const {
+        bool hasNodes = false;
+        for (auto node : set) {
+            if (node != SourceRange::NoLocation) {
+                if (treeIndex.find(node).empty()) {
+                    return false;
+                }
+                hasNodes = true;
+            }
+        }
+        return hasNodes && !knownToFail(set);
+    }
+
+    // Declarations enclosing nodes of the set
+    std::vector<SourceRange> declarationsOf(const RemovalSet& set) const {
+        std::vector<SourceRange> declarations;
+        for (auto node : set) {
+            if (node == SourceRange::NoLocation) {
+                continue;
+            }
+            auto declaration = treeIndex.declarationOf(node);
+            if (std::find(declarations.begin(), declarations.end(), declaration) ==
+                declarations.end()) {
+                declarations.push_back(declaration);
+            }
+        }
+        return declarations;
+    }
+
     /// The default handler invoked when no visit() method is overridden for a particular type.
     /// Will visit all child nodes by default.
     template <typename T>
@@ -63,18 +171,36 @@ class SetRemover : public SyntaxRewriter<SetRemover> {
         removedTypeInfo += (removedTypeInfo.empty() ? "" : ",") + STRINGIZE_NODE_TYPE(T);
     }
 
+    void addTextEdit(const SyntaxNode& node) {
+        auto range = treeIndex.textRange(node);
+        if (!textPatch || !range || treeIndex.isInSeparatedList(node)) {
+            textPatch.reset();
+            return;
+        }
+        textPatch->edits.push_back({range->first, range->second, ""});
+    }
+
     template <typename T>
     void visit(T&& node, bool isNodeRemovable = true) {
         if (isNodeRemovable && pendingNodes.erase(node.sourceRange()) == 1) {
             logType<T>();
             std::cerr << prefixLines(node.toString(), "-") << "\n";
             remove(node);
+            addTextEdit(node);
             return;
         }
         visitDefault(node);
     }
 };
 
-SetRemover makeFunctionArgRemover(std::shared_ptr<SyntaxTree> tree);
-SetRemover makePortsRemover(std::shared_ptr<SyntaxTree> tree);
-SetRemover makeStructFieldRemover(std::shared_ptr<SyntaxTree> tree);
+// Removers of sets of nodes found in elaborated compilation (see ElaborationCache)
+SetRemover makeFunctionArgRemover(Compilation& compilation);
+SetRemover makePortsRemover(Compilation& compilation);
+SetRemover makeStructFieldRemover(Compilation& compilation);
+SetRemover makeCascadeRemover(Compilation& compilation);
+// A set for each top-level declaration that can't be reached from elaborated design
+// (nor from other input files). If topModules are not given, definitions that are not
+// instantiated are included as well.
+SetRemover makeUnreachableDeclRemover(Compilation& compilation,
+                                      std::span<const std::shared_ptr<SyntaxTree>> otherTrees,
+                                      std::span<const std::string> topModules);
@@ -0,0 +1,36 @@
+// SPDX-License-Identifier: Apache-2.0
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+// Minimal streaming SHA-256 (FIPS 180-4), used for identifying attempts by their content
+class Sha256 {
+   public:
+    using Digest = std::array<uint8_t, 32>;
+
+    Sha256();
+
+    Sha256& update(const void* data, size_t len);
+    Sha256& update(std::string_view str) { return update(str.data(), str.size()); }
+    Digest finish();
+
+   private:
+    std::array<uint32_t, 8> state;
+    std::array<uint8_t, 64> block;
+    size_t blockLen;
+    uint64_t totalLen;
+
+    void compress(const uint8_t* chunk);
+};
+
+struct DigestHash {
+    size_t operator()(const Sha256::Digest& digest) const {
+        // digest is uniformly distributed already, any part of it is a good hash
+        size_t hash;
+        memcpy(&hash, digest.data(), sizeof(hash));
+        return hash;
+    }
+};
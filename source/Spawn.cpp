@@ -0,0 +1,116 @@
+// SPDX-License-Identifier: Apache-2.0
+#include "Spawn.hpp"
+#include <signal.h>
+#include <spawn.h>
+#include <atomic>
+#include <cerrno>
+#include <string_view>
+
+extern char** environ;
+
+// Process groups of children that are not reaped yet. Lock-free atomics keep them safe to read
+// from signal handler. Children that don't fit are not tracked.
+static constexpr size_t maxLiveGroups = 1024;
+static std::atomic<pid_t> liveGroups[maxLiveGroups];
+
+static void killLiveGroups(int sig) {
+    for (auto& group : liveGroups) {
+        pid_t pgid = group.load();
+        if (pgid > 0) {
+            kill(-pgid, SIGKILL);
+        }
+    }
+    signal(sig, SIG_DFL);
+    raise(sig);  // delivered once handler returns
+}
+
+static void installSignalHandlers() {
+    static bool installed = false;
+    if (installed) {
+        return;
+    }
+    installed = true;
+    for (int sig : {SIGINT, SIGTERM}) {
+        struct sigaction action = {};
+        sigaction(sig, nullptr, &action);
+        if (action.sa_handler == SIG_IGN) {
+            continue;  // e.g. launched in background by non-interactive shell
+        }
+        action = {};
+        action.sa_handler = killLiveGroups;
+        sigemptyset(&action.sa_mask);
+        sigaction(sig, &action, nullptr);
+    }
+}
+
+static void trackProcess(pid_t pid) {
+    for (auto& group : liveGroups) {
+        pid_t free = 0;
+        if (group.compare_exchange_strong(free, pid)) {
+            return;
+        }
+    }
+}
+
+void forgetProcess(pid_t pid) {
+    for (auto& group : liveGroups) {
+        pid_t tracked = pid;
+        if (group.compare_exchange_strong(tracked, 0)) {
+            return;
+        }
+    }
+}
+
+pid_t spawnProcess(const std::vector<std::string>& args,
+                   const std::vector<std::string>& extraEnv,
+                   const std::vector<std::pair<int, int>>& redirects) {
+    std::vector<char*> argv;
+    for (auto& arg : args) {
+        argv.push_back(const_cast<char*>(arg.c_str()));
+    }
+    argv.push_back(nullptr);
+
+    std::vector<char*> envp;
+    for (char** var = environ; *var; var++) {
+        std::string_view entry(*var);
+        bool overridden = false;
+        for (auto& extra : extraEnv) {
+            overridden |= entry.starts_with(std::string_view(extra).substr(0, extra.find('=') + 1));
+        }
+        if (!overridden) {
+            envp.push_back(*var);
+        }
+    }
+    for (auto& extra : extraEnv) {
+        envp.push_back(const_cast<char*>(extra.c_str()));
+    }
+    envp.push_back(nullptr);
+
+    posix_spawnattr_t attr;
+    posix_spawnattr_init(&attr);
+    // SIGPIPE is ignored by sv-bugpoint (see CheckServer), don't pass that on to the child
+    sigset_t defaultSignals;
+    sigemptyset(&defaultSignals);
+    sigaddset(&defaultSignals, SIGPIPE);
+    posix_spawnattr_setsigdefault(&attr, &defaultSignals);
+    posix_spawnattr_setpgroup(&attr, 0);
+    posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETPGROUP | POSIX_SPAWN_SETSIGDEF);
+
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    for (auto [from, to] : redirects) {
+        posix_spawn_file_actions_adddup2(&actions, from, to);
+    }
+
+    installSignalHandlers();
+    pid_t pid;
+    int rc = posix_spawn(&pid, argv[0], &actions, &attr, argv.data(), envp.data());
+    posix_spawn_file_actions_destroy(&actions);
+    posix_spawnattr_destroy(&attr);
+    if (rc != 0) {
+        errno = rc;
+        return -1;
+    }
+    trackProcess(pid);
+    return pid;
+}
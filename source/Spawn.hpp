@@ -0,0 +1,26 @@
+// SPDX-License-Identifier: Apache-2.0
+#pragma once
+#include <sys/types.h>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Launch args[0] with given arguments in its own process group (so it can be killed together
+// with everything it has spawned). extraEnv entries ("NAME=value") are added to (or override)
+// environment of the current process. Each {from, to} pair of redirects makes child's `to` fd
+// a duplicate of parent's `from` fd.
+//
+// Unlike fork(), posix_spawn() doesn't copy page tables of the parent, so launching doesn't
+// get slower as sv-bugpoint holds more trees in memory.
+// Return pid of the child, or -1 with errno set if it couldn't be launched (exec failures
+// included).
+//
+// As children don't share our process group, Ctrl-C wouldn't reach them. So until reaped (and
+// passed to forgetProcess()), they are killed with their groups when sv-bugpoint gets SIGINT or
+// SIGTERM, before the signal is re-raised.
+pid_t spawnProcess(const std::vector<std::string>& args,
+                   const std::vector<std::string>& extraEnv,
+                   const std::vector<std::pair<int, int>>& redirects = {});
+
+// Stop killing process group of pid on SIGINT/SIGTERM. Meant to be called once child is reaped.
+void forgetProcess(pid_t pid);
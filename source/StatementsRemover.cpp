@@ -21,3 +21,7 @@ template bool rewriteLoop<StatementsRemover>(std::shared_ptr<SyntaxTree>& tree,
                                              std::string stageName,
                                              std::string passIdx,
                                              SvBugpoint* svBugpoint);
+template std::unique_ptr<CandidateProducer> makeCandidateProducer<StatementsRemover>(
+    const std::string& stageName,
+    SvBugpoint* svBugpoint,
+    std::shared_ptr<TreeIndex> treeIndex);
@@ -1,16 +1,25 @@
 // SPDX-License-Identifier: Apache-2.0
 #include "SvBugpoint.hpp"
-#include <fcntl.h>
+#include <poll.h>
 #include <slang/syntax/SyntaxTree.h>
 #include <slang/text/SourceManager.h>
-#include <sys/mman.h>
 #include <sys/stat.h>
+#include <sys/syscall.h>
 #include <sys/wait.h>
+#include <unistd.h>
+#include <algorithm>
 #include <filesystem>
 #include <fstream>
+#include <functional>
 #include <iostream>
+#include <limits>
+#include <map>
+#include <span>
 #include "IncrementalRewritersFwd.hpp"
+#include "RewriteQueue.hpp"
 #include "SetRemovers.hpp"
+#include "Spawn.hpp"
+#include "TextSplice.hpp"
 #include "Utils.hpp"
 
 using namespace slang::syntax;
@@ -22,103 +31,340 @@ bool rewriteLoop(SetRemover rewriter,
                  std::string stageName,
                  std::string passIdx,
                  SvBugpoint* svBugpoint) {
-    bool committed = false;
-    bool traversalDone = false;
+    rewriter.stageName = stageName;
+    rewriter.failureMemo = svBugpoint->getFailureMemo();
+    rewriter.skipKnownFailures = svBugpoint->getSkipKnownFailures();
+    return rewriteQueue(rewriter, tree, stageName, passIdx, svBugpoint);
+}
 
-    while (!traversalDone) {
-        auto stats = AttemptStats(passIdx, stageName, svBugpoint);
-        auto tmpTree = rewriter.transform(tree, traversalDone, stats);
-        if (traversalDone && tmpTree == tree) {
-            break;  // no change - no reason to test
+pid_t SvBugpoint::launchCheck() {
+    // Execute ./sv-bugpoint-check.sh with files of current worker, don't wait for it
+    if (checkServer.value_or(false)) {
+        if (checkServers.size() <= (size_t)currentWorker) {
+            checkServers.resize(currentWorker + 1);
         }
-        if (svBugpoint->test(tmpTree, stats)) {
-            tree = tmpTree;
-            committed = true;
+        auto& server = checkServers[currentWorker];
+        if (!server) {
+            server = std::make_unique<CheckServer>();
+            server->start(getCheckScript(), currentWorker);
         }
+        server->send(getTestArgs());
+        return server->pid;
     }
-    return committed;
-}
 
-bool SvBugpoint::test(AttemptStats& stats) {
-    // Execute ./sv-bugpoint-check.sh tmpFile.
-    // On success (zero exit code) replace minimized file with tmp, and return true.
-    // On fail (non-zero exit code) return false.
-    stats.begin();
-    pid_t pid = fork();
+    std::vector<std::string> args{getCheckScript()};
+    for (auto& arg : getTestArgs()) {
+        args.push_back(arg);
+    }
+    pid_t pid = spawnProcess(args, {"SV_BUGPOINT_WORKER=" + std::to_string(currentWorker)});
     if (pid == -1) {
-        PRINTF_ERR("fork failed: %s\n", strerror(errno));
+        PRINTF_ERR("failed to launch '%s': %s\n", getCheckScript().c_str(), strerror(errno));
         exit(1);
-    } else if (pid == 0) {  // we are inside child
-        auto testArgs = getTestArgs();
-        std::vector<std::string> argvString{};
-        std::vector<char*> argv{};
-        argvString.push_back(getCheckScript());
-        for (auto& arg : testArgs) {
-            argvString.push_back(arg);
-        }
-        for (auto& arg : argvString) {
-            argv.push_back(const_cast<char*>(arg.c_str()));
-        }
-        argv.push_back(nullptr);
-        if (execv(argv[0], argv.data())) {  // replace child with prog
-            PRINTF_ERR("failed to launch '%s': %s\n", getCheckScript().c_str(), strerror(errno));
-            kill(getppid(), SIGINT);  // terminate parent
+    }
+    return pid;
+}
+
+static bool waitUntil(pid_t pid,
+                      int& wstatus,
+                      struct rusage& usage,
+                      std::chrono::time_point<std::chrono::high_resolution_clock> deadline) {
+    // wait4() with a deadline. Return false if child is still running after the deadline.
+    int pidfd = -1;
+#ifdef SYS_pidfd_open
+    pidfd = syscall(SYS_pidfd_open, pid, 0);
+#endif
+    bool exited = false;
+    while (true) {
+        int rc = wait4(pid, &wstatus, WNOHANG, &usage);
+        if (rc < 0) {
+            perror("waitpid failed");
             exit(1);
+        } else if (rc == pid) {
+            exited = true;
+            break;
+        }
+        auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+            deadline - std::chrono::high_resolution_clock::now());
+        if (remaining.count() <= 0) {
+            break;
         }
-    } else {  // we are in parent
-        int wstatus;
-        int rc = waitpid(pid, &wstatus, 0);
-        if (rc <= 0 || !WIFEXITED(wstatus)) {
+        if (pidfd >= 0) {  // pidfd becomes readable when process exits
+            struct pollfd fd = {pidfd, POLLIN, 0};
+            poll(&fd, 1, remaining.count() + 1);
+        } else {  // pidfd is not supported, fall back to polling
+            usleep(std::min<long>(remaining.count() + 1, 10) * 1000);
+        }
+    }
+    if (pidfd >= 0) {
+        close(pidfd);
+    }
+    return exited;
+}
+
+bool SvBugpoint::waitForCheck(pid_t pid, AttemptStats& stats) {
+    // Return true if check script exited with zero (or check server replied with zero).
+    // If it doesn't finish within checkTimeout, kill it with everything it has spawned,
+    // mark the attempt as timed out and return false.
+    auto deadline = stats.startTime + checkTimeout;
+    if (checkServer.value_or(false)) {
+        auto& server = checkServers[currentWorker];
+        if (checkTimeout.count() > 0 && !server->waitForReply(deadline)) {
+            server->forceStop();
+            server.reset();  // fresh one will be started on next attempt
+            stats.timeout = true;
+            return false;
+        }
+        return server->receive();
+    }
+    int wstatus;
+    struct rusage usage;
+    if (checkTimeout.count() == 0) {
+        if (wait4(pid, &wstatus, 0, &usage) <= 0) {
             perror("waitpid failed");
             exit(1);
         }
-        if (WEXITSTATUS(wstatus)) {
-            stats.end(false).report();
-            return false;
-        } else {
-            std::error_code ec;
-            std::filesystem::copy(getTmpFile(), getMinimizedFile(),
-                                  std::filesystem::copy_options::overwrite_existing, ec);
-            stats.end(true).report();
-            saveCombinedOutput();
-            if (ec) {
-                std::cerr << "Error copying file: " << ec.message() << std::endl;
-                exit(1);
-            }
-            return true;
+    } else if (!waitUntil(pid, wstatus, usage, deadline)) {
+        kill(-pid, SIGKILL);
+        wait4(pid, &wstatus, 0, &usage);
+        forgetProcess(pid);
+        stats.setUsage(wstatus, usage);
+        stats.timeout = true;
+        return false;
+    }
+    forgetProcess(pid);
+    stats.setUsage(wstatus, usage);
+    if (!WIFEXITED(wstatus)) {
+        perror("waitpid failed");
+        exit(1);
+    }
+    return WEXITSTATUS(wstatus) == 0;
+}
+
+void SvBugpoint::commitAttempt(AttemptStats& stats) {
+    // Replace minimized file with tmp file of current worker
+    std::error_code ec;
+    std::filesystem::copy(getTmpFile(), getMinimizedFile(),
+                          std::filesystem::copy_options::overwrite_existing, ec);
+    stats.end(true).report();
+    saveCombinedOutput();
+    if (ec) {
+        std::cerr << "Error copying file: " << ec.message() << std::endl;
+        exit(1);
+    }
+}
+
+static void hashFile(Sha256& hash, const fs::path& name, const fs::path& file) {
+    std::ifstream input(file, std::ios::binary);
+    std::string content{std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>()};
+    uint64_t size = content.size();
+    hash.update(name.string()).update("", 1).update(&size, sizeof(size)).update(content);
+}
+
+Sha256::Digest SvBugpoint::hashTestArgs() {
+    // Hash contents of files passed to check script (in the same order as getTestArgs()).
+    // Relative paths are used for naming them, so the hash doesn't depend on the worker
+    // that checks given attempt.
+    Sha256 hash;
+    hash.update(checkScriptDigest.data(), checkScriptDigest.size());
+    for (size_t i = 0; i < minimizedFiles.size(); i++) {
+        if ((int)i != currentPathIdx) {
+            hashFile(hash, relativeFiles[i], minimizedFiles[i]);
         }
     }
+    hashFile(hash, relativeFiles[currentPathIdx], getTmpFile());
+    return hash.finish();
+}
+
+bool SvBugpoint::check(AttemptStats& stats, bool useCache) {
+    // Execute ./sv-bugpoint-check.sh tmpFile, unless the same input was checked before.
+    // Return true if it exited with zero.
+    stats.begin();
+    auto key = hashTestArgs();
+    std::optional<bool> verdict = useCache ? verdictCache.lookup(key) : std::nullopt;
+    if (verdict) {
+        stats.cached = true;
+        return *verdict;
+    }
+    bool passed = waitForCheck(launchCheck(), stats);
+    if (!stats.timeout) {  // timeouts depend on load of the machine, not only on input
+        verdictCache.insert(key, passed);
+    }
+    return passed;
+}
+
+bool SvBugpoint::finishAttempt(AttemptStats& stats, bool passed) {
+    // On success replace minimized file with tmp, and return true. Otherwise return false.
+    if (passed) {
+        commitAttempt(stats);
+        return true;
+    } else {
+        stats.end(false).report();
+        return false;
+    }
+}
 
-    return false;  // just to make compiler happy - will never get here
+bool SvBugpoint::test(AttemptStats& stats, bool useCache) {
+    // Execute ./sv-bugpoint-check.sh tmpFile, unless the same input was checked before.
+    // On success (zero exit code) replace minimized file with tmp, and return true.
+    // On fail (non-zero exit code) return false.
+    return finishAttempt(stats, check(stats, useCache));
 }
 
-bool SvBugpoint::test(std::shared_ptr<SyntaxTree>& tree, AttemptStats& stats) {
-    // Write given tree to tmp file and execute ./sv-bugpoint-check.sh tmpFile.
+bool SvBugpoint::writeTmpFile(const std::shared_ptr<SyntaxTree>& tree,
+                              const std::optional<TextPatch>& patch) {
+    // Write given tree to tmp file. If patch is given, splice it into minimized file rather
+    // than printing whole tree. Return true if it was spliced.
+    if (patch && spliceFile(getMinimizedFile(), *patch, getTmpFile())) {
+        return true;
+    }
     std::ofstream tmpFile;
     tmpFile.rdbuf()->pubsetbuf(
         0, 0);  // Enable unbuffered io. Has to be called before open to be effective
     tmpFile.open(getTmpFile());
     tmpFile << SyntaxPrinter::printFile(*tree);
-    return test(stats);
+    return false;
+}
+
+void SvBugpoint::verifySplicedTmpFile(const std::shared_ptr<SyntaxTree>& tree) {
+    // Patches rely on assumptions about how rewrites change printed text. With --verify-splices,
+    // check them on each passing spliced attempt (at the cost of printing the whole tree, which
+    // splicing avoids), and abort on mismatch, as minimized file would no longer match the tree.
+    if (!verifySplices.value_or(false)) {
+        return;
+    }
+    std::ifstream input(getTmpFile(), std::ios::binary);
+    std::string spliced{std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>()};
+    if (spliced != SyntaxPrinter::printFile(*tree)) {
+        PRINTF_ERR("spliced attempt %d differs from printed tree\n", currentAttemptIdx);
+        exit(1);
+    }
+}
+
+bool SvBugpoint::test(std::shared_ptr<SyntaxTree>& tree,
+                      AttemptStats& stats,
+                      const std::optional<TextPatch>& patch) {
+    // Write given tree to tmp file and execute ./sv-bugpoint-check.sh tmpFile.
+    bool spliced = writeTmpFile(tree, patch);
+    bool passed = check(stats);
+    if (passed && spliced) {
+        verifySplicedTmpFile(tree);
+    }
+    return finishAttempt(stats, passed);
+}
+
+size_t SvBugpoint::testSpeculatively(std::vector<std::shared_ptr<SyntaxTree>>& trees,
+                                     std::vector<AttemptStats>& stats,
+                                     const std::vector<std::optional<TextPatch>>& patches) {
+    // Check trees derived from the same base concurrently, each in tmp dir of separate worker.
+    // Results are handled in order: the first passing tree gets committed, and since later
+    // trees were built on a base that is no longer current, their checks are dropped.
+    // Return index of committed tree, or trees.size() if none passed.
+    ASSERT(trees.size() <= (size_t)jobs, "more attempts than workers");
+    if (trees.size() == 1) {
+        return test(trees[0], stats[0], patches[0]) ? 0 : 1;
+    }
+
+    // pid of -1 marks attempts that are not run - either the verdict is cached, or the attempt
+    // is skipped
+    std::vector<pid_t> pids(trees.size(), -1);
+    std::vector<Sha256::Digest> keys(trees.size());
+    std::vector<std::optional<bool>> cachedVerdicts(trees.size());
+    std::vector<bool> spliced(trees.size());
+    bool passKnown = false;
+    for (size_t i = 0; i < trees.size(); i++) {
+        currentWorker = i;
+        if (passKnown) {
+            continue;  // not even prepared, as a preceding attempt is already known to pass
+        }
+        spliced[i] = writeTmpFile(trees[i], patches[i]);
+        stats[i].begin();
+        keys[i] = hashTestArgs();
+        if (auto verdict = verdictCache.lookup(keys[i])) {
+            stats[i].cached = true;
+            cachedVerdicts[i] = verdict;
+            passKnown = *verdict;
+        } else {
+            pids[i] = launchCheck();
+        }
+    }
+
+    size_t committedIdx = trees.size();
+    for (size_t i = 0; i < trees.size(); i++) {
+        currentWorker = i;
+        if (committedIdx < trees.size()) {
+            if (pids[i] != -1 && checkServer.value_or(false)) {
+                // server is too valuable to be killed, just ignore its reply
+                waitForCheck(pids[i], stats[i]);
+            } else if (pids[i] != -1) {
+                kill(-pids[i], SIGKILL);
+                waitpid(pids[i], nullptr, 0);
+                forgetProcess(pids[i]);
+            }
+            continue;
+        }
+
+        bool passed;
+        if (cachedVerdicts[i]) {
+            passed = *cachedVerdicts[i];
+        } else {
+            passed = waitForCheck(pids[i], stats[i]);
+            if (!stats[i].timeout) {
+                verdictCache.insert(keys[i], passed);
+            }
+        }
+        if (passed && spliced[i]) {
+            verifySplicedTmpFile(trees[i]);
+        }
+        if (finishAttempt(stats[i], passed)) {
+            committedIdx = i;
+        }
+    }
+    currentWorker = 0;
+    return committedIdx;
+}
+
+std::shared_ptr<SyntaxTree> TreeLoader::get(fs::path file) {
+    auto it = entries.find(file);
+    if (it != entries.end()) {
+        return it->second.latestTree;
+    }
+    return load(file);
 }
 
 std::shared_ptr<SyntaxTree> TreeLoader::load(fs::path file) {
     // Creating new SourceManager is the simplest way of tree reloading as of now.
     // See https://github.com/MikePopoloski/slang/discussions/733
-    delete sourceManager;
-    sourceManager = new SourceManager;
-    SyntaxTree::TreeOrError treeOrErr = SyntaxTree::fromFile(std::string(file), *sourceManager);
+    auto& entry = entries[file];
+    entry.latestTree = nullptr;
+    entry.failureMemo.clear();
+    entry.enumeratedCandidates.clear();
+    entry.elaboration.clear();
+    entry.originalTree = nullptr;
+    delete entry.sourceManager;
+    entry.sourceManager = new SourceManager;
+    SyntaxTree::TreeOrError treeOrErr =
+        SyntaxTree::fromFile(std::string(file), *entry.sourceManager);
     if (!treeOrErr) {
         PRINTF_ERR("failed to load tree from '%s' file: %s\n", file.c_str(),
                    std::string(treeOrErr.error().second).c_str());
         exit(1);
     }
-    originalTree = *treeOrErr;
-    return originalTree;
+    entry.originalTree = *treeOrErr;
+    entry.latestTree = entry.originalTree;
+    return entry.latestTree;
+}
+
+void TreeLoader::update(fs::path file, std::shared_ptr<SyntaxTree> tree) {
+    entries.at(file).latestTree = tree;
 }
 
 TreeLoader::~TreeLoader() {
-    delete sourceManager;
+    for (auto& [file, entry] : entries) {
+        entry.latestTree = nullptr;
+        entry.elaboration.clear();
+        entry.originalTree = nullptr;
+        delete entry.sourceManager;
+    }
 }
 
 char* getNextDelim(char* line, char* end) {
@@ -134,91 +380,231 @@ char* getNextDelim(char* line, char* end) {
     return end;
 }
 
-bool lineRemover(std::shared_ptr<SyntaxTree>& tree,
-                 const std::string& stageName,
-                 const std::string& passIdx,
-                 SvBugpoint* svBugpoint) {
-    // Remove preprocessor directives, empty lines and line comments line-by-line
-    copyFile(svBugpoint->getMinimizedFile(), svBugpoint->getTmpFile());
-    int fd = open(svBugpoint->getTmpFile().c_str(), O_RDWR);
-    if (fd < 0) {
-        perror("open");
-        return false;
-    }
-
-    struct stat st;
-    if (fstat(fd, &st) < 0) {
-        perror("fstat");
-        close(fd);
-        return false;
+static bool removeChunks(const std::function<bool(size_t, size_t)>& tryRemoving,
+                         size_t begin,
+                         size_t end,
+                         bool knownToFail) {
+    // Try to remove items (e.g. lines) [begin, end) at once, and bisect them on failure
+    // (like rewriteBisect). Return true if all of them were removed.
+    if (begin == end || (!knownToFail && tryRemoving(begin, end))) {
+        return true;
     }
-
-    size_t fileSize = st.st_size;
-    if (fileSize == 0) {
-        close(fd);
+    if (end - begin == 1) {
         return false;
     }
+    size_t mid = begin + (end - begin) / 2;
+    // If the whole first half got removed, the culprit is in the second one
+    bool firstRemoved = removeChunks(tryRemoving, begin, mid, false);
+    removeChunks(tryRemoving, mid, end, firstRemoved);
+    return false;
+}
 
-    char* data =
-        static_cast<char*>(mmap(nullptr, fileSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0));
-    if (data == MAP_FAILED) {
-        perror("mmap");
-        close(fd);
-        return false;
-    }
+bool lineRemover(std::shared_ptr<SyntaxTree>& tree,
+                 const std::string& stageName,
+                 const std::string& passIdx,
+                 SvBugpoint* svBugpoint) {
+    // Remove preprocessor directives, empty lines and line comments. There may be thousands of
+    // them in preprocessed input, so all of them are tried at once first, and bisected on
+    // failure (unless merging attempts is disabled with --n-at-once 1).
+    std::ifstream input(svBugpoint->getMinimizedFile(), std::ios::binary);
+    std::string text{std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>()};
+    input.close();
 
-    bool committed = false;
+    // removable lines, as ranges of original text
+    std::vector<TextRange> lines;
+    char* data = text.data();
     char* nextDelim = nullptr;
     char* line = data;
-    std::string removedLine;
-    while ((nextDelim = getNextDelim(line, data + fileSize))) {
-        char* nextLine = nextDelim != (data + fileSize) ? nextDelim + 1 : nextDelim;
+    while ((nextDelim = getNextDelim(line, data + text.size()))) {
+        char* nextLine = nextDelim != (data + text.size()) ? nextDelim + 1 : nextDelim;
         char* firstPrintable = line;
         // NOTE: we assume here that \r is always part of \r\n
         // It won't work for pre-OSX Macs newlines (single \r)
         while (*firstPrintable == ' ' || *firstPrintable == '\t' || *firstPrintable == '\r') {
             firstPrintable++;
         }
-        if (!((*firstPrintable == '`') ||
-              (*firstPrintable == '/' && *(firstPrintable + 1) == '/') ||
-              (*firstPrintable == '\n'))) {
-            line = nextLine;
-            continue;
+        if ((*firstPrintable == '`') || (*firstPrintable == '/' && *(firstPrintable + 1) == '/') ||
+            (*firstPrintable == '\n')) {
+            lines.push_back({(size_t)(line - data), (size_t)(nextLine - data)});
         }
-        size_t skipLen = nextLine - line;
-        size_t remainingLen = fileSize - (nextLine - data);
-        removedLine.assign(line, skipLen);  // backup to be able to revert
-        memmove(line, nextLine, remainingLen);
+        line = nextLine;
+    }
 
-        if (ftruncate(fd, fileSize - skipLen) < 0) {
-            perror("ftruncate");
-            munmap(data, fileSize);
-            close(fd);
-            exit(-1);  // must exit, the file is in an inconsistent state
+    // minimized file, i.e. text without lines removed so far
+    PieceTable minimized(std::move(text));
+    bool committed = false;
+    auto tryRemoving = [&](size_t begin, size_t end) {
+        auto removal = std::span<const TextRange>(lines).subspan(begin, end - begin);
+        if (!minimized.write(svBugpoint->getTmpFile(), removal)) {
+            PRINTF_ERR("failed to write '%s'\n", svBugpoint->getTmpFile().c_str());
+            exit(1);
         }
         auto stats = AttemptStats(passIdx, stageName, svBugpoint);
-        if (svBugpoint->test(stats)) {
-            fileSize -= skipLen;
-            committed = true;
-        } else {
-            // go one line back, write the missing line, go where we were
-            if (ftruncate(fd, fileSize) < 0) {
-                perror("ftruncate (restore)");
-                munmap(data, fileSize);
-                close(fd);
-                exit(-1);
-            }
-            memmove(line + skipLen, line, remainingLen);
-            memcpy(line, removedLine.data(), skipLen);
-            line = nextLine;
+        stats.batch = end - begin;
+        if (!svBugpoint->test(stats)) {
+            return false;
+        }
+        minimized.remove(removal);
+        committed = true;
+        return true;
+    };
+
+    if (svBugpoint->n_at_once > 1) {
+        removeChunks(tryRemoving, 0, lines.size(), false);
+    } else {
+        for (size_t i = 0; i < lines.size(); i++) {
+            tryRemoving(i, i + 1);
         }
     }
-    munmap(data, fileSize);
-    close(fd);
 
     // reload tree to reflect changes done
-    tree = svBugpoint->treeLoader.load(svBugpoint->getMinimizedFile());
+    if (committed) {
+        tree = svBugpoint->treeLoader.load(svBugpoint->getMinimizedFile());
+    }
+
+    return committed;
+}
+
+static std::vector<TextRange> findTokenGroups(std::span<const TreeIndex::TokenText> tokens) {
+    // Balanced token ranges that may be removable regardless of syntax they are part of:
+    // contents of (), [] and {} groups, whole [] groups and attribute lists, and
+    // comma-separated items of groups (along with one of adjacent commas).
+    using parsing::TokenKind;
+    auto closingKind = [](TokenKind kind) {
+        switch (kind) {
+            case TokenKind::OpenParenthesis:
+                return TokenKind::CloseParenthesis;
+            case TokenKind::OpenBracket:
+                return TokenKind::CloseBracket;
+            case TokenKind::OpenBrace:
+            case TokenKind::ApostropheOpenBrace:
+                return TokenKind::CloseBrace;
+            case TokenKind::OpenParenthesisStar:
+                return TokenKind::StarCloseParenthesis;
+            default:
+                return TokenKind::Unknown;
+        }
+    };
+    struct Group {
+        size_t open;
+        size_t lastComma;  // the same as open if there is none yet
+    };
+
+    std::vector<TextRange> groups;
+    std::vector<Group> stack;
+    for (size_t i = 0; i < tokens.size(); i++) {
+        auto kind = tokens[i].kind;
+        if (closingKind(kind) != TokenKind::Unknown) {
+            stack.push_back({i, i});
+            continue;
+        }
+        if (kind == TokenKind::Comma && !stack.empty()) {
+            auto& group = stack.back();
+            if (group.lastComma + 1 < i) {
+                groups.push_back({tokens[group.lastComma + 1].begin, tokens[i].end});
+            }
+            group.lastComma = i;
+            continue;
+        }
+        // the group may be unbalanced (e.g. due to skipped tokens), so look for its opening
+        auto opening = std::find_if(stack.rbegin(), stack.rend(), [&](const Group& group) {
+            return closingKind(tokens[group.open].kind) == kind;
+        });
+        if (opening == stack.rend()) {
+            continue;
+        }
+        auto group = *opening;
+        stack.erase(std::prev(opening.base()), stack.end());
+        if (group.open + 1 < i) {
+            groups.push_back({tokens[group.open + 1].begin, tokens[i - 1].end});
+        }
+        if (kind == TokenKind::CloseBracket || kind == TokenKind::StarCloseParenthesis) {
+            groups.push_back({tokens[group.open].begin, tokens[i].end});
+        }
+        if (group.lastComma != group.open && group.lastComma + 1 < i) {
+            groups.push_back({tokens[group.lastComma].begin, tokens[i - 1].end});
+        }
+    }
+
+    // outer ranges first, so they are tried before ranges nested in them
+    std::sort(groups.begin(), groups.end(), [](const TextRange& a, const TextRange& b) {
+        return a.begin != b.begin ? a.begin < b.begin : a.end > b.end;
+    });
+    groups.erase(std::unique(groups.begin(), groups.end(),
+                             [](const TextRange& a, const TextRange& b) {
+                                 return a.begin == b.begin && a.end == b.end;
+                             }),
+                 groups.end());
+    return groups;
+}
+
+bool tokenReducer(std::shared_ptr<SyntaxTree>& tree,
+                  const std::string& stageName,
+                  const std::string& passIdx,
+                  SvBugpoint* svBugpoint) {
+    // Remove balanced token ranges (see findTokenGroups) that no syntax-level stage targets,
+    // e.g. parts of expressions, attribute lists or arguments. Like in lineRemover, they are
+    // tried all at once first, and bisected on failure.
+    std::ifstream input(svBugpoint->getMinimizedFile(), std::ios::binary);
+    std::string text{std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>()};
+    input.close();
+    auto treeIndex = svBugpoint->getTreeIndex(tree);
+    if (treeIndex->textSize() != text.size()) {
+        return false;  // file doesn't hold the printed tree, so token offsets are invalid
+    }
+    auto groups = findTokenGroups(treeIndex->tokens());
+
+    // ranges of groups can be nested, so ones overlapping with removed ones are skipped
+    std::map<size_t, size_t> removed;  // begin -> end
+    auto isRemoved = [&](const TextRange& range) {
+        auto next = removed.upper_bound(range.begin);
+        if (next != removed.end() && next->first < range.end) {
+            return true;
+        }
+        return next != removed.begin() && std::prev(next)->second > range.begin;
+    };
+
+    PieceTable minimized(std::move(text));
+    bool committed = false;
+    auto tryRemoving = [&](size_t begin, size_t end) {
+        std::vector<TextRange> removal;
+        for (size_t i = begin; i < end; i++) {
+            if ((removal.empty() || groups[i].begin >= removal.back().end) &&
+                !isRemoved(groups[i])) {
+                removal.push_back(groups[i]);
+            }
+        }
+        if (removal.empty()) {
+            return true;  // nothing left to remove
+        }
+        if (!minimized.write(svBugpoint->getTmpFile(), removal)) {
+            PRINTF_ERR("failed to write '%s'\n", svBugpoint->getTmpFile().c_str());
+            exit(1);
+        }
+        auto stats = AttemptStats(passIdx, stageName, svBugpoint);
+        stats.batch = removal.size();
+        if (!svBugpoint->test(stats)) {
+            return false;
+        }
+        minimized.remove(removal);
+        for (auto range : removal) {
+            removed.emplace(range.begin, range.end);
+        }
+        committed = true;
+        return true;
+    };
+
+    if (svBugpoint->n_at_once > 1) {
+        removeChunks(tryRemoving, 0, groups.size(), false);
+    } else {
+        for (size_t i = 0; i < groups.size(); i++) {
+            tryRemoving(i, i + 1);
+        }
+    }
 
+    if (committed) {
+        tree = svBugpoint->treeLoader.load(svBugpoint->getMinimizedFile());
+    }
     return committed;
 }
 
@@ -247,39 +633,148 @@ bool fileTruncator(std::shared_ptr<SyntaxTree>& tree,
     return false;
 }
 
-bool SvBugpoint::pass(const std::string& passIdx) {
+using StageFn = std::function<bool(std::shared_ptr<SyntaxTree>&,
+                                    const std::string& stageName,
+                                    const std::string& passIdx,
+                                    SvBugpoint* svBugpoint)>;
+
+using ProducerFn = std::unique_ptr<CandidateProducer> (*)(const std::string& stageName,
+                                                         SvBugpoint* svBugpoint,
+                                                         std::shared_ptr<TreeIndex> treeIndex);
+
+struct Stage {
+    std::string name;
+    StageFn run;
+    // for enumerating candidates of the stage together with other stages (if supported)
+    ProducerFn makeProducer = nullptr;
+};
+
+// All stages in the order of fixed schedule
+static std::vector<Stage> getStages(bool withLineRemover,
+                                    bool withCascadeRemover,
+                                    bool withTokenReducer) {
+    std::vector<Stage> stages = {
+        {"fileTruncator", fileTruncator},
+        {"bodyRemover", rewriteLoop<BodyRemover>, makeCandidateProducer<BodyRemover>},
+        {"instantiationRemover", rewriteLoop<InstantationRemover>,
+         makeCandidateProducer<InstantationRemover>},
+        {"bindRemover", rewriteLoop<BindRemover>, makeCandidateProducer<BindRemover>},
+        {"bodyPartsRemover", rewriteLoop<BodyPartsRemover>,
+         makeCandidateProducer<BodyPartsRemover>},
+        {"ifBodyReplacer", rewriteLoop<IfBodyReplacer>, makeCandidateProducer<IfBodyReplacer>},
+        {"elseBodyReplacer", rewriteLoop<ElseBodyReplacer>,
+         makeCandidateProducer<ElseBodyReplacer>},
+        {"externInliner", rewriteLoop<ExternInliner>},
+        {"declRemover", rewriteLoop<DeclRemover>, makeCandidateProducer<DeclRemover>},
+        {"statementsRemover", rewriteLoop<StatementsRemover>,
+         makeCandidateProducer<StatementsRemover>},
+        {"importsRemover", rewriteLoop<ImportsRemover>, makeCandidateProducer<ImportsRemover>},
+        {"paramAssignRemover", rewriteLoop<ParamAssignRemover>,
+         makeCandidateProducer<ParamAssignRemover>},
+        {"contAssignRemover", rewriteLoop<ContAssignRemover>,
+         makeCandidateProducer<ContAssignRemover>},
+        {"memberRemover", rewriteLoop<MemberRemover>, makeCandidateProducer<MemberRemover>},
+        {"modportRemover", rewriteLoop<ModportRemover>, makeCandidateProducer<ModportRemover>},
+        {"portsRemover",
+         [](std::shared_ptr<SyntaxTree>& tree, const std::string& stageName,
+            const std::string& passIdx, SvBugpoint* svBugpoint) {
+             return rewriteLoop(makePortsRemover(svBugpoint->getCompilation(tree)), tree,
+                                stageName, passIdx, svBugpoint);
+         }},
+        {"structRemover",
+         [](std::shared_ptr<SyntaxTree>& tree, const std::string& stageName,
+            const std::string& passIdx, SvBugpoint* svBugpoint) {
+             return rewriteLoop(makeStructFieldRemover(svBugpoint->getCompilation(tree)), tree,
+                                stageName, passIdx, svBugpoint);
+         }},
+        {"functionArgRemover",
+         [](std::shared_ptr<SyntaxTree>& tree, const std::string& stageName,
+            const std::string& passIdx, SvBugpoint* svBugpoint) {
+             return rewriteLoop(makeFunctionArgRemover(svBugpoint->getCompilation(tree)), tree,
+                                stageName, passIdx, svBugpoint);
+         }},
+        {"moduleRemover", rewriteLoop<ModuleRemover>, makeCandidateProducer<ModuleRemover>},
+        {"typeSimplifier", rewriteLoop<TypeSimplifier>, makeCandidateProducer<TypeSimplifier>},
+        {"LabelRemover", rewriteLoop<LabelRemover>, makeCandidateProducer<LabelRemover>},
+    };
+    if (withCascadeRemover) {
+        // before memberRemover, whose attempts fail while declarations are still used
+        auto memberRemover = std::find_if(stages.begin(), stages.end(), [](const Stage& stage) {
+            return stage.name == "memberRemover";
+        });
+        stages.insert(memberRemover,
+                      {"cascadeRemover",
+                       [](std::shared_ptr<SyntaxTree>& tree, const std::string& stageName,
+                          const std::string& passIdx, SvBugpoint* svBugpoint) {
+                           return rewriteLoop(makeCascadeRemover(svBugpoint->getCompilation(tree)),
+                                              tree, stageName, passIdx, svBugpoint);
+                       }});
+    }
+    if (withTokenReducer) {
+        stages.push_back({"tokenReducer", tokenReducer});
+    }
+    if (withLineRemover) {
+        stages.push_back({"lineRemover", lineRemover});
+    }
+    return stages;
+}
+
+bool SvBugpoint::pass(const std::string& passIdx, bool fullSweep) {
     bool commited = false;
+    auto stages = getStages(!disableLineRemover.value_or(false), cascadeRemover.value_or(false),
+                            enableTokenReducer.value_or(false));
+    skipKnownFailures = !fullSweep;
 
     for (size_t i = 0; i < minimizedFiles.size(); i++) {
         currentPathIdx = i;
 
-        auto tree = treeLoader.load(getMinimizedFile());
-
-        commited |= fileTruncator(tree, "fileTruncator", passIdx, this);
-        commited |= rewriteLoop<BodyRemover>(tree, "bodyRemover", passIdx, this);
-        commited |= rewriteLoop<InstantationRemover>(tree, "instantiationRemover", passIdx, this);
-        commited |= rewriteLoop<BindRemover>(tree, "bindRemover", passIdx, this);
-        commited |= rewriteLoop<BodyPartsRemover>(tree, "bodyPartsRemover", passIdx, this);
-        commited |= rewriteLoop<IfBodyReplacer>(tree, "ifBodyReplacer", passIdx, this);
-        commited |= rewriteLoop<ElseBodyReplacer>(tree, "elseBodyReplacer", passIdx, this);
-        commited |= rewriteLoop<ExternInliner>(tree, "externInliner", passIdx, this);
-        commited |= rewriteLoop<DeclRemover>(tree, "declRemover", passIdx, this);
-        commited |= rewriteLoop<StatementsRemover>(tree, "statementsRemover", passIdx, this);
-        commited |= rewriteLoop<ImportsRemover>(tree, "importsRemover", passIdx, this);
-        commited |= rewriteLoop<ParamAssignRemover>(tree, "paramAssignRemover", passIdx, this);
-        commited |= rewriteLoop<ContAssignRemover>(tree, "contAssignRemover", passIdx, this);
-        commited |= rewriteLoop<MemberRemover>(tree, "memberRemover", passIdx, this);
-        commited |= rewriteLoop<ModportRemover>(tree, "modportRemover", passIdx, this);
-        commited |= rewriteLoop(makePortsRemover(tree), tree, "portsRemover", passIdx, this);
-        commited |= rewriteLoop(makeStructFieldRemover(tree), tree, "structRemover", passIdx, this);
-        commited |=
-            rewriteLoop(makeFunctionArgRemover(tree), tree, "functionArgRemover", passIdx, this);
-        commited |= rewriteLoop<ModuleRemover>(tree, "moduleRemover", passIdx, this);
-        commited |= rewriteLoop<TypeSimplifier>(tree, "typeSimplifier", passIdx, this);
-        commited |= rewriteLoop<LabelRemover>(tree, "LabelRemover", passIdx, this);
-        if (!disableLineRemover.value_or(false)) {
-            commited |= lineRemover(tree, "lineRemover", passIdx, this);
+        auto tree = treeLoader.get(getMinimizedFile());
+
+        if (candidateOrder == CandidateOrder::Size) {
+            // Find candidates of all stages in single traversal. Stages are run one after
+            // another, but candidates are identified by source ranges, so they remain valid
+            // after commits of preceding stages (they become no-ops if removed).
+            std::vector<std::unique_ptr<CandidateProducer>> producers;
+            std::vector<CandidateProducer*> producerPtrs;
+            std::vector<std::string> producerStages;
+            for (auto& stage : stages) {
+                if (stage.makeProducer) {
+                    producers.push_back(stage.makeProducer(stage.name, this, getTreeIndex(tree)));
+                    producerPtrs.push_back(producers.back().get());
+                    producerStages.push_back(stage.name);
+                }
+            }
+            enumerateCandidates(tree->root(), producerPtrs);
+            auto& enumerated = treeLoader.getEnumeratedCandidates(getMinimizedFile());
+            for (size_t j = 0; j < producers.size(); j++) {
+                enumerated[producerStages[j]] = producers[j]->takeCandidates();
+            }
+        }
+
+        if (schedule == Schedule::Adaptive) {
+            // Most productive stages go first, so the following ones work on smaller input.
+            // Stages that haven't run on the file yet keep their fixed order at the front.
+            auto yieldOf = [&](const Stage& stage) {
+                auto it = lastStageRuns.find({currentPathIdx, stage.name});
+                return it == lastStageRuns.end() ? std::numeric_limits<double>::infinity()
+                                                 : it->second.linesPerSecond();
+            };
+            std::stable_sort(stages.begin(), stages.end(), [&](const Stage& a, const Stage& b) {
+                return yieldOf(a) > yieldOf(b);
+            });
         }
+
+        for (auto& stage : stages) {
+            auto lastRun = lastStageRuns.find({currentPathIdx, stage.name});
+            if (schedule == Schedule::Adaptive && !fullSweep && lastRun != lastStageRuns.end() &&
+                lastRun->second.linesRemoved == 0) {
+                continue;
+            }
+            StageYield before = getStageYield(stage.name);
+            commited |= stage.run(tree, stage.name, passIdx, this);
+            lastStageRuns[{currentPathIdx, stage.name}] = getStageYield(stage.name) - before;
+        }
+        treeLoader.update(getMinimizedFile(), tree);
     }
 
     return commited;
@@ -287,11 +782,22 @@ bool SvBugpoint::pass(const std::string& passIdx) {
 
 void SvBugpoint::minimize() {
     removeVerilatorConfig();
+    if (removeUnreachable.value_or(false)) {
+        removeUnreachableDecls();
+    }
     int passIdx = 1;
-    bool committed;
-    do {
-        committed = pass(std::to_string(passIdx++));
-    } while (committed);
+    // Adaptive schedule skips unproductive stages, and --retry-changed-only skips reductions
+    // that failed before, so once a pass commits nothing, everything is tried once more,
+    // to make sure nothing can reduce the result any further.
+    bool skipsAnything = schedule == Schedule::Adaptive || retryChangedOnly.value_or(false);
+    bool fullSweep = true;
+    while (true) {
+        bool committed = pass(std::to_string(passIdx++), fullSweep);
+        if (!committed && fullSweep) {
+            break;
+        }
+        fullSweep = !skipsAnything || !committed;
+    }
 }
 
 void SvBugpoint::removeVerilatorConfig() {
@@ -324,6 +830,45 @@ void SvBugpoint::removeVerilatorConfig() {
     }
 }
 
+void SvBugpoint::removeUnreachableDecls() {
+    // Unreachable declarations are removed by declRemover and moduleRemover one by one (or in
+    // batches of nearby ones). Try to remove all of them in a single attempt instead, bisecting
+    // only if it fails.
+    std::string stageName = "unreachableDeclRemover";
+    for (size_t i = 0; i < minimizedFiles.size(); i++) {
+        currentPathIdx = i;
+        auto tree = treeLoader.get(getMinimizedFile());
+        std::vector<std::shared_ptr<SyntaxTree>> otherTrees;
+        for (size_t j = 0; j < minimizedFiles.size(); j++) {
+            if (j != i) {
+                otherTrees.push_back(treeLoader.get(minimizedFiles[j]));
+            }
+        }
+        auto rewriter = makeUnreachableDeclRemover(getCompilation(tree), otherTrees, topModules);
+        rewriter.stageName = stageName;
+        rewriter.failureMemo = getFailureMemo();
+
+        while (!rewriter.traversalDone) {
+            size_t start = rewriter.remaining;
+            auto stats = AttemptStats("-", stageName, this);
+            auto tmpTree = rewriter.transform(tree, stats, rewriter.remaining);
+            if (rewriter.traversalDone && tmpTree == tree) {
+                break;
+            }
+            if (test(tmpTree, stats, rewriter.textPatch)) {
+                rewriter.recordOutcome(rewriter.remaining, start - rewriter.remaining, true);
+                tree = tmpTree;
+            } else if (stats.batch > 1) {
+                rewriter.remaining = start;
+                rewriteQueueBisectFailed(rewriter, tree, stageName, "-", this, stats.batch);
+            }
+            rewriter.applyCommits();
+            rewriter.traversalDone = rewriter.remaining == 0;
+        }
+        treeLoader.update(getMinimizedFile(), tree);
+    }
+}
+
 fs::path findCommonAncestor(fs::path a, fs::path b) {
     fs::path common;
     auto it_a = a.begin();
@@ -353,7 +898,7 @@ void SvBugpoint::initOutDir() {
     for (auto& input : inputFiles) {
         fs::path relative = fs::relative(input, commonInputAncestor);
         minimizedFiles.push_back(getOutDir() / relative);
-        tmpFiles.push_back(getTmpOutDir() / relative);
+        relativeFiles.push_back(relative);
     }
 
     mkdir(getWorkDir());
@@ -365,7 +910,9 @@ void SvBugpoint::initOutDir() {
         }
     }
     mkdir(getOutDir());
-    mkdir(getTmpOutDir());
+    for (int worker = 0; worker < jobs; worker++) {
+        mkdir(getTmpOutDir(worker));
+    }
     mkdir(getDebugDir());
     if (saveIntermediates.value_or(false)) {
         mkdir(getIntermediateDir());
@@ -375,22 +922,40 @@ void SvBugpoint::initOutDir() {
     for (size_t i = 0; i < inputFiles.size(); i++) {
         currentPathIdx = i;
         mkdir(getMinimizedFile().parent_path());
-        mkdir(getTmpFile().parent_path());
+        for (int worker = 0; worker < jobs; worker++) {
+            mkdir((getTmpOutDir(worker) / relativeFiles[i]).parent_path());
+        }
         copyFile(getOriginalFile(), getMinimizedFile());
         copyFile(getOriginalFile(), getTmpFile());
     }
     AttemptStats::writeHeader(getTraceFile());
     saveCombinedOutput();
+
+    Sha256 scriptHash;
+    hashFile(scriptHash, getCheckScript().filename(), getCheckScript());
+    checkScriptDigest = scriptHash.finish();
+    // Verdicts from previous runs in the same dir may be reused (e.g. after sv-bugpoint-resume)
+    verdictCache.open(getVerdictCacheFile(), reuseVerdicts.value_or(false));
 }
 
 void SvBugpoint::dryRun() {
     auto info = AttemptStats("-", "dryRun", this);
     info.typeInfo = "-";
-    if (!test(info)) {
+    // always run the script, as it may behave differently than when the cache was populated
+    if (!test(info, false)) {
         PRINTF_ERR("'%s %s' exited with non-zero on dry run with unmodified input\n",
                    getCheckScript().c_str(), getTmpFile().c_str());
         exit(1);
     }
+
+    // Attempts rarely take much longer than the unmodified input, unless reduction
+    // made it hang (e.g. infinite loop in simulation). Don't let such ones stall minimization.
+    if (timeoutFactor > 0) {
+        auto baseline = std::chrono::duration_cast<std::chrono::milliseconds>(
+            (info.endTime - info.startTime) * timeoutFactor);
+        checkTimeout = std::clamp(baseline, std::chrono::milliseconds(std::chrono::seconds(1)),
+                                  std::chrono::milliseconds(std::chrono::seconds(timeoutMax)));
+    }
 }
 
 void SvBugpoint::checkDumpTrees() {
@@ -442,6 +1007,34 @@ void SvBugpoint::addArgs() {
     cmdLine.add("--force", force, "overwrite files in outDir without prompting");
     cmdLine.add("--save-intermediates", saveIntermediates, "save output of each removal attempt");
     cmdLine.add("--dump-trees", dump, "dump parse tree and elaborated AST of input code");
+    cmdLine.add("--check-server", checkServer,
+                "Launch check script once (per job) and pass attempts to it over stdin.\n"
+                "For each attempt the script receives a line with tab-separated paths,\n"
+                "and has to reply with a line with 0 (property preserved) or 1 on stdout.");
+    cmdLine.add("--retry-changed-only", retryChangedOnly,
+                "In later passes, retry failed reductions only if their enclosing module,\n"
+                "class or function has changed since. Everything is retried in the last pass.");
+    cmdLine.add("--reuse-verdicts", reuseVerdicts,
+                "Reuse verdicts of check script runs from previous run in the same outDir\n"
+                "(see debug/verdicts), e.g. when resuming. Use only if outcome of the check\n"
+                "can't have changed since (e.g. the tool under test is the same version).");
+    cmdLine.add("--remove-unreachable", removeUnreachable,
+                "Before the first pass, try to remove all modules, packages, classes and\n"
+                "functions unreachable from elaborated design at once.");
+    cmdLine.add("--top", topModules,
+                "Top module of the design (may be given multiple times), for\n"
+                "--remove-unreachable. Without it, modules that aren't instantiated anywhere\n"
+                "(the actual top included) are candidates for removal too.",
+                "<name>");
+    cmdLine.add("--cascade-remover", cascadeRemover,
+                "Enable stage that removes declarations of variables, nets, parameters and\n"
+                "typedefs together with all statements and connections that use them.");
+    cmdLine.add("--token-reducer", enableTokenReducer,
+                "Enable stage (run after syntax-level ones) that removes balanced groups of\n"
+                "tokens, like contents of parentheses or comma-separated items.");
+    cmdLine.add("--verify-splices", verifySplices,
+                "Check that each passing attempt written by splicing text edits into minimized\n"
+                "file is the same as the printed tree, and abort otherwise (for debugging).");
     cmdLine.add("--fno-line-remover", disableLineRemover,
                 "Disable line remover.\n"
                 "WARNING: This option is experimental only, and will be removed eventually.");
@@ -468,9 +1061,68 @@ void SvBugpoint::addArgs() {
             return "";
         },
         "Speculatively merge up to n reductions into a single one.\n"
-        "Default (32) should be good for most cases.\n"
-        "n=1 disables merging entirely.",
+        "It is the initial value, each stage grows it after passing attempts, and\n"
+        "shrinks it after failing ones (default 32). n=1 disables merging entirely.",
+        "<n>");
+    cmdLine.add(
+        "-j,--jobs",
+        [this](std::string_view value) {
+            jobs = std::max(1, std::stoi(std::string(value)));
+            return "";
+        },
+        "Run up to n check scripts at once (default 1).\n"
+        "Each of them is given files from separate tmp dir, and SV_BUGPOINT_WORKER\n"
+        "environment variable set to its index. Results do not depend on n.",
         "<n>");
+    cmdLine.add(
+        "--schedule",
+        [this](std::string_view value) -> std::string {
+            if (value == "fixed") {
+                schedule = Schedule::Fixed;
+            } else if (value == "adaptive") {
+                schedule = Schedule::Adaptive;
+            } else {
+                return "expected 'fixed' or 'adaptive'";
+            }
+            return "";
+        },
+        "Order of stages within a pass (default fixed). 'adaptive' runs stages in order\n"
+        "of lines removed per second of check time on their last run, and skips the ones\n"
+        "that removed nothing, until a pass that runs all of them commits nothing.",
+        "fixed|adaptive");
+    cmdLine.add(
+        "--candidate-order",
+        [this](std::string_view value) -> std::string {
+            if (value == "windows") {
+                candidateOrder = CandidateOrder::LineWindows;
+            } else if (value == "size") {
+                candidateOrder = CandidateOrder::Size;
+            } else {
+                return "expected 'windows' or 'size'";
+            }
+            return "";
+        },
+        "Order in which nodes are tried by each stage (default windows). 'windows' tries\n"
+        "nodes at least 1024 lines long, then 512, and so on, traversing tree for each size.\n"
+        "'size' collects them in single traversal, and tries them sorted by line count.",
+        "windows|size");
+    cmdLine.add(
+        "--timeout-factor",
+        [this](std::string_view value) {
+            timeoutFactor = std::stod(std::string(value));
+            return "";
+        },
+        "Kill check script (with all its descendants) and treat attempt as failed\n"
+        "if it runs k times longer than on dry run (but at least 1s).\n"
+        "k=0 (the default) disables timeout.",
+        "<k>");
+    cmdLine.add(
+        "--timeout-max",
+        [this](std::string_view value) {
+            timeoutMax = std::max(1, std::stoi(std::string(value)));
+            return "";
+        },
+        "Upper limit for timeout set by --timeout-factor, in seconds (default 3600).", "<secs>");
     cmdLine.setPositional(
         [this](std::string_view value) {
             if (workDir.empty()) {
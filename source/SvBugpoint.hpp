@@ -2,32 +2,65 @@
 #pragma once
 #include <slang/syntax/SyntaxTree.h>
 #include <slang/util/CommandLine.h>
+#include <sys/types.h>
+#include <map>
 #include <string>
+#include "BatchSizeController.hpp"
+#include "CandidateEnumerator.hpp"
+#include "CheckServer.hpp"
+#include "ElaborationCache.hpp"
+#include "FailureMemo.hpp"
+#include "TextSplice.hpp"
+#include "TreeIndex.hpp"
 #include "Utils.hpp"
+#include "VerdictCache.hpp"
 
 namespace fs = std::filesystem;
 
-// simple helper for (re)loading tree and keeping required resources alive until next reload
+// simple helper for (re)loading trees and keeping required resources alive until next reload.
+// Latest tree of each file is cached, so it is reparsed only after its text was modified
+// by text-level stages.
 class TreeLoader {
    public:
+    // Return latest tree of given file, parse it if it isn't cached yet
+    std::shared_ptr<SyntaxTree> get(fs::path file);
+    // Parse given file again (e.g. after it was modified on text level)
     std::shared_ptr<SyntaxTree> load(fs::path file);
+    // Remember tree committed by syntax-level stages as the latest one of given file
+    void update(fs::path file, std::shared_ptr<SyntaxTree> tree);
+    // Failed reductions of latest tree of given file (cleared on load, as ranges change)
+    FailureMemo& getFailureMemo(fs::path file) { return entries.at(file).failureMemo; }
+    ElaborationCache& getElaboration(fs::path file) { return entries.at(file).elaboration; }
+    // Candidates of stages enumerated at once, until they are taken by the stages
+    // (cleared on load too)
+    std::map<std::string, std::vector<RewriteCandidate>>& getEnumeratedCandidates(fs::path file) {
+        return entries.at(file).enumeratedCandidates;
+    }
     ~TreeLoader();
 
-    TreeLoader() : originalTree(nullptr), sourceManager(nullptr) {}
+    TreeLoader() = default;
     TreeLoader(const TreeLoader&) = delete;
     TreeLoader& operator=(const TreeLoader&) = delete;
 
    private:
-    // https://github.com/MikePopoloski/slang/commit/dc010f37a82898e7ca5365d8a32c86f127b49b34
-    // is incomplete. Given A->B->C->D chain of tree transforms B,C,D still depend on original
-    // A tree. Hence, original tree must be kept alive until next load
-    std::shared_ptr<SyntaxTree> originalTree;
-    SourceManager* sourceManager;
+    struct Entry {
+        // https://github.com/MikePopoloski/slang/commit/dc010f37a82898e7ca5365d8a32c86f127b49b34
+        // is incomplete. Given A->B->C->D chain of tree transforms B,C,D still depend on
+        // original A tree. Hence, original tree must be kept alive until next load of the file
+        std::shared_ptr<SyntaxTree> originalTree;
+        SourceManager* sourceManager = nullptr;
+        std::shared_ptr<SyntaxTree> latestTree;
+        FailureMemo failureMemo;
+        std::map<std::string, std::vector<RewriteCandidate>> enumeratedCandidates;
+        // refers to trees, so it has to be cleared before their SourceManager is deleted
+        ElaborationCache elaboration;
+    };
+    std::map<fs::path, Entry> entries;
 };
 
 class SvBugpoint {
    public:
-    SvBugpoint() : currentPathIdx(0), currentAttemptIdx(0) {}
+    SvBugpoint() : currentPathIdx(0), currentAttemptIdx(0), currentWorker(0) {}
 
     void addArgs();
     void usage();
@@ -46,22 +79,35 @@ class SvBugpoint {
     void dryRun();
     void initOutDir();
     void removeVerilatorConfig();
+    void removeUnreachableDecls();
     void minimize();
-    bool pass(const std::string& passIdx = "-");
+    // Run all stages on each file. Unless fullSweep is set, adaptive schedule skips stages
+    // that removed nothing on their last run, and with --retry-changed-only, reductions known
+    // to fail are skipped. Return true if anything was committed.
+    bool pass(const std::string& passIdx = "-", bool fullSweep = true);
 
-    bool test(AttemptStats& stats);
-    bool test(std::shared_ptr<SyntaxTree>& tree, AttemptStats& stats);
+    bool test(AttemptStats& stats, bool useCache = true);
+    bool test(std::shared_ptr<SyntaxTree>& tree,
+              AttemptStats& stats,
+              const std::optional<TextPatch>& patch = std::nullopt);
+    size_t testSpeculatively(std::vector<std::shared_ptr<SyntaxTree>>& trees,
+                             std::vector<AttemptStats>& stats,
+                             const std::vector<std::optional<TextPatch>>& patches);
     void checkDumpTrees();
 
     fs::path getWorkDir() { return workDir; }
     fs::path getOutDir() { return workDir / "minimized"; }
-    fs::path getTmpOutDir() { return workDir / "tmp"; }
+    fs::path getTmpOutDir() { return getTmpOutDir(currentWorker); }
+    fs::path getTmpOutDir(int worker) {
+        // each worker gets its own copy of tmp dir, so concurrent attempts don't clash
+        return worker == 0 ? workDir / "tmp" : workDir / ("tmp-" + std::to_string(worker));
+    }
     fs::path getDebugDir() { return workDir / "debug"; }
     fs::path getIntermediateDir() { return getDebugDir() / "attempts"; }
 
     fs::path getOriginalFile() { return inputFiles[currentPathIdx]; }
     fs::path getMinimizedFile() { return minimizedFiles[currentPathIdx]; }
-    fs::path getTmpFile() { return tmpFiles[currentPathIdx]; }
+    fs::path getTmpFile() { return getTmpOutDir() / relativeFiles[currentPathIdx]; }
 
     std::string getExtension() { return getOriginalFile().extension(); }
     std::string getStem() { return getOriginalFile().stem(); }
@@ -73,6 +119,7 @@ class SvBugpoint {
     }
 
     fs::path getTraceFile() { return getDebugDir() / "trace"; }
+    fs::path getVerdictCacheFile() { return getDebugDir() / "verdicts"; }
     fs::path getDumpSyntaxFile() { return getDebugDir() / "syntax-dump"; }
     fs::path getDumpAstFile() { return getDebugDir() / "ast-dump"; }
     fs::path getCombinedOutputFile() { return workDir / "sv-bugpoint-combined.sv"; }
@@ -103,28 +150,127 @@ class SvBugpoint {
 
     // Speculatively merge up to n minimization attempts into
     // single one to reduce check script calls.
-    // Currently it only applies to IncrementalRewriters.
+    // It is the initial size only, each stage adjusts it (see BatchSizeController).
     int n_at_once = 32;
 
+    BatchSizeController& getBatchSize(const std::string& stageName) {
+        return batchSizes.try_emplace(stageName, n_at_once).first->second;
+    }
+
+    // Failed reductions of current file, or nullptr if they are not tracked
+    FailureMemo* getFailureMemo() {
+        return retryChangedOnly.value_or(false) ? &treeLoader.getFailureMemo(getMinimizedFile())
+                                                : nullptr;
+    }
+    bool getSkipKnownFailures() { return skipKnownFailures; }
+
+    // Order in which rewriters try candidates: largest first within power-of-two line windows,
+    // or sorted by size (see IncrementalRewriter)
+    enum class CandidateOrder { LineWindows, Size };
+    CandidateOrder candidateOrder = CandidateOrder::LineWindows;
+
+    // Candidates of given stage found by enumerateCandidates() in current file
+    std::optional<std::vector<RewriteCandidate>> takeEnumeratedCandidates(
+        const std::string& stageName) {
+        auto& enumerated = treeLoader.getEnumeratedCandidates(getMinimizedFile());
+        auto it = enumerated.find(stageName);
+        if (it == enumerated.end()) {
+            return std::nullopt;
+        }
+        auto candidates = std::move(it->second);
+        enumerated.erase(it);
+        return candidates;
+    }
+
+    // Elaborated compilation of given tree of current file, shared by stages
+    Compilation& getCompilation(const std::shared_ptr<SyntaxTree>& tree) {
+        return treeLoader.getElaboration(getMinimizedFile()).get(tree);
+    }
+
+    // Index of given tree, shared by stages, as they mostly transform the same tree
+    std::shared_ptr<TreeIndex> getTreeIndex(const std::shared_ptr<SyntaxTree>& tree) {
+        if (!treeIndex || !treeIndex->isBuiltFor(tree)) {
+            treeIndex = std::make_shared<TreeIndex>(tree);
+        }
+        return treeIndex;
+    }
+
+    // Reduction yield of given stage summed over all its attempts
+    StageYield& getStageYield(const std::string& stageName) { return stageYields[stageName]; }
+
+    // Run stages in fixed order, or ordered by yield of their last run (see pass())
+    enum class Schedule { Fixed, Adaptive };
+    Schedule schedule = Schedule::Fixed;
+
+    // Number of check script instances that may run at once.
+    // Attempts that would be tried next if the current one failed are checked speculatively.
+    int jobs = 1;
+
+    // Attempt is killed after running timeoutFactor times longer than the dry run
+    // (at least 1s, at most timeoutMax seconds). 0 (the default) disables timeout.
+    double timeoutFactor = 0;
+    int timeoutMax = 3600;
+
    private:
     CommandLine cmdLine;
 
     fs::path commonInputAncestor;
     std::vector<fs::path> inputFiles;
     std::vector<fs::path> minimizedFiles;
-    std::vector<fs::path> tmpFiles;
+    std::vector<fs::path> relativeFiles;
 
     int currentPathIdx;
     // Global counter incremented after end of each attempt
     // Meant mainly for setting up conditional breakpoints based on trace
     int currentAttemptIdx;
+    // Worker whose tmp dir is used by the attempt that is being prepared/checked
+    int currentWorker;
     std::string checkScript;
     std::optional<bool> dump;
     std::optional<bool> force;
     // Flag for saving intermediate output of each attempt
     std::optional<bool> saveIntermediates;
     std::optional<bool> disableLineRemover;
+    // Retry failed reductions only after their surroundings have changed
+    std::optional<bool> retryChangedOnly;
+    // Remove unreachable declarations before the first pass
+    std::optional<bool> removeUnreachable;
+    // Tops of the design, from which reachability is determined
+    std::vector<std::string> topModules;
+    // Load verdicts persisted by previous run in the same outDir
+    std::optional<bool> reuseVerdicts;
+    // Remove declarations together with their uses
+    std::optional<bool> cascadeRemover;
+    // Remove balanced groups of tokens after syntax-level stages
+    std::optional<bool> enableTokenReducer;
+    // Compare spliced attempts with printed trees (see verifySplicedTmpFile())
+    std::optional<bool> verifySplices;
+    bool skipKnownFailures = false;
+    // Keep check script running, and pass attempts to it over a pipe
+    std::optional<bool> checkServer;
+    std::vector<std::unique_ptr<CheckServer>> checkServers;  // one per worker
     std::optional<bool> showHelp;
     fs::path workDir;
     flat_hash_set<fs::path> activeCommandFiles;
+    VerdictCache verdictCache;
+    // Mixed into verdict cache keys, so verdicts of other check scripts are not reused
+    Sha256::Digest checkScriptDigest;
+    // Derived from timeoutFactor on dry run, 0 means no timeout
+    std::chrono::milliseconds checkTimeout{0};
+    // batch sizes of stages, kept across passes
+    std::map<std::string, BatchSizeController> batchSizes;
+    std::map<std::string, StageYield> stageYields;
+    std::shared_ptr<TreeIndex> treeIndex;
+    // yield of the last run of each stage on each file, indexed by (file index, stage name)
+    std::map<std::pair<int, std::string>, StageYield> lastStageRuns;
+
+    Sha256::Digest hashTestArgs();
+    bool writeTmpFile(const std::shared_ptr<SyntaxTree>& tree,
+                      const std::optional<TextPatch>& patch = std::nullopt);
+    void verifySplicedTmpFile(const std::shared_ptr<SyntaxTree>& tree);
+    bool check(AttemptStats& stats, bool useCache = true);
+    bool finishAttempt(AttemptStats& stats, bool passed);
+    pid_t launchCheck();
+    bool waitForCheck(pid_t pid, AttemptStats& stats);
+    void commitAttempt(AttemptStats& stats);
 };
@@ -0,0 +1,109 @@
+// SPDX-License-Identifier: Apache-2.0
+#include "TextSplice.hpp"
+#include <fcntl.h>
+#include <limits.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+
+static bool writeAll(int fd, std::vector<iovec>& iov) {
+    // writev() may write less than requested, and accepts at most IOV_MAX entries at once
+    size_t first = 0;
+    while (first < iov.size()) {
+        int count = std::min<size_t>(iov.size() - first, IOV_MAX);
+        ssize_t written = writev(fd, &iov[first], count);
+        if (written < 0 && errno == EINTR) {
+            continue;
+        } else if (written < 0) {
+            return false;
+        }
+        while (first < iov.size() && (size_t)written >= iov[first].iov_len) {
+            written -= iov[first].iov_len;
+            first++;
+        }
+        if (written > 0) {
+            iov[first].iov_base = static_cast<char*>(iov[first].iov_base) + written;
+            iov[first].iov_len -= written;
+        }
+    }
+    return true;
+}
+
+bool spliceFile(const std::filesystem::path& base,
+                const TextPatch& patch,
+                const std::filesystem::path& out) {
+    int baseFd = open(base.c_str(), O_RDONLY);
+    if (baseFd < 0) {
+        return false;
+    }
+    struct stat st;
+    if (fstat(baseFd, &st) < 0 || (size_t)st.st_size != patch.baseSize ||
+        patch.baseSize == 0) {
+        close(baseFd);
+        return false;
+    }
+    void* mapping = mmap(nullptr, patch.baseSize, PROT_READ, MAP_PRIVATE, baseFd, 0);
+    close(baseFd);
+    if (mapping == MAP_FAILED) {
+        return false;
+    }
+    char* data = static_cast<char*>(mapping);
+
+    std::vector<iovec> iov;
+    size_t pos = 0;
+    bool valid = true;
+    for (auto& edit : patch.edits) {
+        if (edit.begin < pos || edit.end < edit.begin || edit.end > patch.baseSize) {
+            valid = false;
+            break;
+        }
+        iov.push_back({data + pos, edit.begin - pos});
+        iov.push_back({const_cast<char*>(edit.replacement.data()), edit.replacement.size()});
+        pos = edit.end;
+    }
+    iov.push_back({data + pos, patch.baseSize - pos});
+    std::erase_if(iov, [](const iovec& vec) { return vec.iov_len == 0; });
+
+    if (valid) {
+        int outFd = open(out.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        valid = outFd >= 0 && writeAll(outFd, iov);
+        if (outFd >= 0) {
+            valid &= close(outFd) == 0;
+        }
+    }
+    munmap(mapping, patch.baseSize);
+    return valid;
+}
+
+std::vector<TextRange> PieceTable::keptPieces(std::span<const TextRange> skipped) const {
+    std::vector<TextRange> kept;
+    auto skip = skipped.begin();
+    for (auto piece : pieces) {
+        size_t pos = piece.begin;
+        for (; skip != skipped.end() && skip->begin < piece.end; skip++) {
+            kept.push_back({pos, skip->begin});
+            pos = skip->end;
+        }
+        kept.push_back({pos, piece.end});
+    }
+    std::erase_if(kept, [](const TextRange& range) { return range.begin == range.end; });
+    return kept;
+}
+
+bool PieceTable::write(const std::filesystem::path& out,
+                       std::span<const TextRange> skipped) const {
+    std::vector<iovec> iov;
+    for (auto piece : keptPieces(skipped)) {
+        iov.push_back({const_cast<char*>(text.data()) + piece.begin, piece.end - piece.begin});
+    }
+    int outFd = open(out.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (outFd < 0) {
+        return false;
+    }
+    bool valid = writeAll(outFd, iov);
+    valid &= close(outFd) == 0;
+    return valid;
+}
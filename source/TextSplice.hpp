@@ -0,0 +1,57 @@
+// SPDX-License-Identifier: Apache-2.0
+#pragma once
+#include <cstddef>
+#include <filesystem>
+#include <span>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Replacement of [begin, end) byte range of some text
+struct TextEdit {
+    size_t begin;
+    size_t end;
+    std::string replacement;
+};
+
+// Edits that turn printed base tree into printed rewritten tree.
+// baseSize guards against applying them to a file that doesn't hold the base tree.
+struct TextPatch {
+    size_t baseSize;
+    std::vector<TextEdit> edits;
+};
+
+// Write content of base file with patch applied to out file, without assembling it in
+// memory. Return false (leaving out in unspecified state) if base doesn't match the patch,
+// or edits are out of order.
+bool spliceFile(const std::filesystem::path& base,
+                const TextPatch& patch,
+                const std::filesystem::path& out);
+
+// [begin, end) byte range of some text
+struct TextRange {
+    size_t begin;
+    size_t end;
+};
+
+// Text of a file kept in memory as pieces of its original text, for text-level stages.
+// Removing ranges only splits pieces (rather than moving the rest of the text), and attempts
+// are written out with writev(), without assembling them in memory.
+class PieceTable {
+   public:
+    explicit PieceTable(std::string text)
+        : text(std::move(text)), pieces{{0, this->text.size()}} {}
+
+    // Remove given ranges of original text (sorted, disjoint, and not removed yet)
+    void remove(std::span<const TextRange> ranges) { pieces = keptPieces(ranges); }
+    // Write the text without given ranges (like in remove()) to out file.
+    // Return false on I/O error.
+    bool write(const std::filesystem::path& out, std::span<const TextRange> skipped = {}) const;
+
+   private:
+    std::string text;
+    // kept ranges of original text, in order
+    std::vector<TextRange> pieces;
+
+    std::vector<TextRange> keptPieces(std::span<const TextRange> skipped) const;
+};
@@ -0,0 +1,124 @@
+// SPDX-License-Identifier: Apache-2.0
+#include "TreeIndex.hpp"
+#include <slang/syntax/AllSyntax.h>
+#include <slang/syntax/SyntaxPrinter.h>
+#include <algorithm>
+
+static SyntaxPrinter makeFilePrinter() {
+    // settings of SyntaxPrinter::printFile()
+    SyntaxPrinter printer;
+    printer.setIncludeDirectives(true)
+        .setIncludeSkipped(true)
+        .setIncludeTrivia(true)
+        .setSquashNewlines(false);
+    return printer;
+}
+
+std::string printForSplice(const SyntaxNode& node) {
+    return makeFilePrinter().print(node).str();
+}
+
+void TreeIndex::build(const std::shared_ptr<SyntaxTree>& tree) {
+    this->tree = tree;
+    nodes.clear();
+    preordersByRange.clear();
+    nodesByPreorder.clear();
+    tokenTexts.clear();
+    declarations.clear();
+    nextPreorder = 0;
+    textEnd = 0;
+    indexNode(tree->root(), false, SourceRange::NoLocation);
+}
+
+static bool isDeclaration(const SyntaxNode& node) {
+    return ModuleDeclarationSyntax::isKind(node.kind) ||
+           ClassDeclarationSyntax::isKind(node.kind) ||
+           FunctionDeclarationSyntax::isKind(node.kind);
+}
+
+unsigned TreeIndex::indexNode(const SyntaxNode& node,
+                              bool inSeparatedList,
+                              SourceRange declaration) {
+    // Return number of newlines in node, and record info about node and all its descendants
+    uint32_t preorder = nextPreorder++;
+    size_t textBegin = textEnd;
+    preordersByRange[node.sourceRange()].push_back(preorder);
+    nodesByPreorder.push_back(&node);
+    // nodes sharing the range (e.g. a list and its only element) get the outermost declaration
+    declarations.try_emplace(node.sourceRange(), declaration);
+    // only the root is indexed without enclosing declaration
+    if (declaration == SourceRange::NoLocation || isDeclaration(node)) {
+        declaration = node.sourceRange();
+    }
+    unsigned count = 0;
+    for (size_t i = 0; i < node.getChildCount(); i++) {
+        if (auto child = node.childNode(i)) {
+            count += indexNode(*child, node.kind == SyntaxKind::SeparatedList, declaration);
+        } else if (auto token = node.childToken(i)) {
+            count += std::ranges::count(token.toString(), '\n');
+            // with printFile() settings, printer has no state carried between tokens,
+            // so whole text is just a concatenation of printed tokens
+            textEnd += makeFilePrinter().print(token).str().size();
+            if (!token.isMissing()) {
+                // trivia is printed before the token itself
+                tokenTexts.push_back({token.kind, textEnd - token.rawText().size(), textEnd});
+            }
+        }
+    }
+    nodes[&node] = {count, preorder, nextPreorder, textBegin, textEnd, inSeparatedList};
+    return count;
+}
+
+unsigned TreeIndex::lineCount(const SyntaxNode& node) const {
+    auto it = nodes.find(&node);
+    if (it != nodes.end()) {
+        return it->second.newlines + 1;
+    }
+    // node is not part of indexed tree (e.g. it was created by a rewriter)
+    return std::ranges::count(node.toString(), '\n') + 1;
+}
+
+std::span<const uint32_t> TreeIndex::find(SourceRange range) const {
+    auto it = preordersByRange.find(range);
+    if (it == preordersByRange.end()) {
+        return {};
+    }
+    return it->second;
+}
+
+const SyntaxNode* TreeIndex::findNode(SourceRange range, SyntaxKind kind) const {
+    for (auto preorder : find(range)) {
+        if (nodesByPreorder[preorder]->kind == kind) {
+            return nodesByPreorder[preorder];
+        }
+    }
+    return nullptr;
+}
+
+bool TreeIndex::subtreeContains(const SyntaxNode& node,
+                                std::span<const uint32_t> preorders) const {
+    auto it = nodes.find(&node);
+    if (it == nodes.end()) {
+        return true;
+    }
+    auto first = std::ranges::lower_bound(preorders, it->second.preorder);
+    return first != preorders.end() && *first < it->second.subtreeEnd;
+}
+
+std::optional<std::pair<size_t, size_t>> TreeIndex::textRange(const SyntaxNode& node) const {
+    auto it = nodes.find(&node);
+    if (it == nodes.end()) {
+        return std::nullopt;
+    }
+    return std::make_pair(it->second.textBegin, it->second.textEnd);
+}
+
+bool TreeIndex::isInSeparatedList(const SyntaxNode& node) const {
+    auto it = nodes.find(&node);
+    return it != nodes.end() && it->second.inSeparatedList;
+}
+
+SourceRange TreeIndex::declarationOf(SourceRange range) const {
+    auto it = declarations.find(range);
+    return it == declarations.end() ? SourceRange::NoLocation : it->second;
+}
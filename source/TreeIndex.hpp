@@ -0,0 +1,90 @@
+// SPDX-License-Identifier: Apache-2.0
+#pragma once
+#include <slang/syntax/SyntaxNode.h>
+#include <slang/syntax/SyntaxTree.h>
+#include <slang/util/Hash.h>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <utility>
+#include <unordered_map>
+#include <vector>
+
+using namespace slang::syntax;
+using namespace slang;
+
+// Side tables for a single syntax tree (line counts, preorder positions and offsets in printed
+// text of nodes), computed in one traversal.
+//
+// Rewriters filter candidates by their size on every visit, and computing it with
+// node.toString() prints each node again for each of its ancestors, on every transform.
+// The index is keyed by node addresses, so it is valid only for the tree it was built from
+// (transforms clone the tree).
+class TreeIndex {
+   public:
+    TreeIndex() = default;
+    explicit TreeIndex(const std::shared_ptr<SyntaxTree>& tree) { build(tree); }
+
+    void build(const std::shared_ptr<SyntaxTree>& tree);
+    bool isBuiltFor(const std::shared_ptr<SyntaxTree>& tree) const { return this->tree == tree; }
+
+    // Number of lines spanned by node, i.e. count(node.toString(), '\n') + 1
+    unsigned lineCount(const SyntaxNode& node) const;
+
+    // Preorder positions of nodes with given source range, in ascending order
+    // (it is usually unique, but e.g. a list and its only element share the range)
+    std::span<const uint32_t> find(SourceRange range) const;
+    // Node of given kind and source range, if there is any in the indexed tree
+    const SyntaxNode* findNode(SourceRange range, SyntaxKind kind) const;
+    // Whether any of nodes at given (sorted) preorder positions is node itself or one of its
+    // descendants. Nodes that are not part of the indexed tree are assumed to contain everything.
+    bool subtreeContains(const SyntaxNode& node, std::span<const uint32_t> preorders) const;
+
+    // [begin, end) byte range of node in the text of whole tree printed with printFile().
+    // Unknown for nodes that are not part of indexed tree.
+    std::optional<std::pair<size_t, size_t>> textRange(const SyntaxNode& node) const;
+    // Size of the text of whole tree printed with printFile()
+    size_t textSize() const { return textEnd; }
+    // Removing element of a separated list removes a separator too, so it isn't a plain
+    // removal of node's text
+    bool isInSeparatedList(const SyntaxNode& node) const;
+    // Tokens of the tree in order, with [begin, end) byte ranges of their text (without trivia)
+    // in the text printed with printFile()
+    struct TokenText {
+        parsing::TokenKind kind;
+        size_t begin;
+        size_t end;
+    };
+    std::span<const TokenText> tokens() const { return tokenTexts; }
+    // Range of the nearest module, class or function declaration that encloses node with given
+    // range (the root if there is none). NoLocation for the root itself and unknown ranges.
+    SourceRange declarationOf(SourceRange range) const;
+
+   private:
+    struct NodeInfo {
+        unsigned newlines;
+        // node's descendants occupy (preorder, subtreeEnd) range of preorder positions
+        uint32_t preorder;
+        uint32_t subtreeEnd;
+        size_t textBegin;
+        size_t textEnd;
+        bool inSeparatedList;
+    };
+
+    // kept alive so node addresses can't be reused by another tree
+    std::shared_ptr<SyntaxTree> tree;
+    flat_hash_map<const SyntaxNode*, NodeInfo> nodes;
+    std::unordered_map<SourceRange, std::vector<uint32_t>> preordersByRange;
+    std::vector<const SyntaxNode*> nodesByPreorder;
+    std::vector<TokenText> tokenTexts;
+    std::unordered_map<SourceRange, SourceRange> declarations;
+    uint32_t nextPreorder = 0;
+    size_t textEnd = 0;
+
+    unsigned indexNode(const SyntaxNode& node, bool inSeparatedList, SourceRange declaration);
+};
+
+// Print node the same way as SyntaxPrinter::printFile() prints whole tree
+std::string printForSplice(const SyntaxNode& node);
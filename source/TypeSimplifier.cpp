@@ -36,7 +36,7 @@ class TypeSimplifier : public IncrementalRewriter<TypeSimplifier> {
     }
 
     ShouldVisitChildren handle(const DataTypeSyntax& node, bool isNodeRemovable) {
-        if (shouldReplace(node) && canSimplify(&node)) {
+        if (canSimplify(&node) && shouldReplace(node)) {
             replaceNode(node, *makeIntNode(node.sourceRange().start()));
         }
         return VISIT_CHILDREN;
@@ -47,3 +47,7 @@ template bool rewriteLoop<TypeSimplifier>(std::shared_ptr<SyntaxTree>& tree,
                                           std::string stageName,
                                           std::string passIdx,
                                           SvBugpoint* svBugpoint);
+template std::unique_ptr<CandidateProducer> makeCandidateProducer<TypeSimplifier>(
+    const std::string& stageName,
+    SvBugpoint* svBugpoint,
+    std::shared_ptr<TreeIndex> treeIndex);
@@ -8,6 +8,7 @@
 #include <sys/wait.h>
 #include <unistd.h>
 #include <cstring>
+#include <limits>
 #include "SvBugpoint.hpp"
 
 #ifdef __GLIBCXX__
@@ -168,13 +169,14 @@ int countLines(const std::string& filename) {
 AttemptStats& AttemptStats::begin() {
     linesBefore = countLines(svBugpoint->getMinimizedFile());
     startTime = std::chrono::high_resolution_clock::now();
-    idx = svBugpoint->getCurrentAttemptIdx();
     return *this;
 }
 AttemptStats& AttemptStats::end(bool committed) {
     this->committed = committed;
     linesAfter = countLines(svBugpoint->getMinimizedFile());
     endTime = std::chrono::high_resolution_clock::now();
+    // assigned at the end, as speculative attempts may begin before preceding ones end
+    idx = svBugpoint->getCurrentAttemptIdx();
     if (svBugpoint->getSaveIntermediates()) {
         copyFile(svBugpoint->getTmpFile(), svBugpoint->getAttemptOutput());
     }
@@ -182,13 +184,44 @@ AttemptStats& AttemptStats::end(bool committed) {
     return *this;
 }
 
+AttemptStats& AttemptStats::setUsage(int waitStatus, const struct rusage& usage) {
+    hasUsage = true;
+    this->waitStatus = waitStatus;
+    this->usage = usage;
+    return *this;
+}
+
+static long toMillis(const struct timeval& time) {
+    return time.tv_sec * 1000 + time.tv_usec / 1000;
+}
+
 std::string AttemptStats::toStr() const {
     std::stringstream tmp;
     int lines = linesBefore - linesAfter;
     auto duration =
         std::chrono::duration_cast<std::chrono::milliseconds>(endTime - startTime).count();
     tmp << pass << '\t' << stage << '\t' << lines << '\t' << committed << '\t' << duration << "ms\t"
-        << idx << '\t' << typeInfo << '\t' << svBugpoint->getShortPath() << "\n";
+        << idx << '\t' << typeInfo << '\t' << svBugpoint->getShortPath() << '\t' << cached
+        << '\t' << timeout << '\t';
+    if (hasUsage) {
+        // ru_maxrss is in kilobytes on Linux
+        tmp << toMillis(usage.ru_utime) << "ms\t" << toMillis(usage.ru_stime) << "ms\t"
+            << usage.ru_maxrss << "kB\t";
+        if (WIFEXITED(waitStatus)) {
+            tmp << WEXITSTATUS(waitStatus);
+        } else {
+            tmp << "sig" << WTERMSIG(waitStatus);
+        }
+    } else {
+        tmp << "-\t-\t-\t-";
+    }
+    tmp << '\t';
+    if (batch > 0) {
+        tmp << batch;
+    } else {
+        tmp << '-';
+    }
+    tmp << "\n";
     return tmp.str();
 }
 
@@ -196,11 +229,36 @@ void AttemptStats::report() {
     std::cerr << toStr();
     std::ofstream file(svBugpoint->getTraceFile(), std::ios_base::app);
     file << toStr() << std::flush;
+    svBugpoint->getStageYield(stage).add(*this);
+}
+
+void StageYield::add(const AttemptStats& stats) {
+    if (stats.committed) {
+        linesRemoved += stats.linesBefore - stats.linesAfter;
+    }
+    checkTime += stats.endTime - stats.startTime;
+    attempts++;
+}
+
+double StageYield::linesPerSecond() const {
+    if (checkTime.count() <= 0) {
+        return attempts ? 0 : std::numeric_limits<double>::infinity();
+    }
+    return linesRemoved / checkTime.count();
+}
+
+StageYield StageYield::operator-(const StageYield& rhs) const {
+    StageYield diff;
+    diff.linesRemoved = linesRemoved - rhs.linesRemoved;
+    diff.checkTime = checkTime - rhs.checkTime;
+    diff.attempts = attempts - rhs.attempts;
+    return diff;
 }
 
 void AttemptStats::writeHeader(std::string traceFilePath) {
     std::ofstream file(traceFilePath);
-    file << "pass\tstage\tlines_removed\tcommitted\ttime\tidx\ttype_info\tinput_file\n";
+    file << "pass\tstage\tlines_removed\tcommitted\ttime\tidx\ttype_info\tinput_file\tcached\t"
+            "timeout\tutime\tstime\tmax_rss\texit_status\tbatch\n";
 }
 
 std::string prefixLines(const std::string& str, const std::string& linePrefix) {
@@ -2,6 +2,7 @@
 #pragma once
 #include <slang/parsing/Token.h>
 #include <slang/syntax/SyntaxTree.h>
+#include <sys/resource.h>
 #include <chrono>
 #include <span>
 #include <string>
@@ -26,14 +27,33 @@ class AttemptStats {
     std::chrono::time_point<std::chrono::high_resolution_clock> startTime;
     std::chrono::time_point<std::chrono::high_resolution_clock> endTime;
     bool committed;
+    // verdict was taken from cache instead of running check script
+    bool cached;
+    // check script was killed for exceeding the timeout
+    bool timeout;
+    // resources used by check script, as reported by wait4()
+    // (unknown for cached attempts and for check server)
+    bool hasUsage;
+    // number of reductions merged into the attempt (0 if it doesn't apply to the stage)
+    size_t batch;
+    struct rusage usage;
+    int waitStatus;
     std::string typeInfo;
     int idx;
 
     AttemptStats(const std::string& pass, const std::string& stage, SvBugpoint* svBugpoint)
-        : pass(pass), stage(stage), committed(false), svBugpoint(svBugpoint) {}
+        : pass(pass),
+          stage(stage),
+          committed(false),
+          cached(false),
+          timeout(false),
+          hasUsage(false),
+          batch(0),
+          svBugpoint(svBugpoint) {}
 
     AttemptStats& begin();
     AttemptStats& end(bool committed);
+    AttemptStats& setUsage(int waitStatus, const struct rusage& usage);
     std::string toStr() const;
     void report();
     static void writeHeader(std::string traceFilePath);
@@ -42,6 +62,18 @@ class AttemptStats {
     SvBugpoint* svBugpoint;
 };
 
+// Aggregate of reported attempts of a stage, used for scheduling stages by their yield
+struct StageYield {
+    long linesRemoved = 0;
+    std::chrono::duration<double> checkTime{0};
+    int attempts = 0;
+
+    void add(const AttemptStats& stats);
+    // lines removed per second of check time (infinity if nothing was checked yet)
+    double linesPerSecond() const;
+    StageYield operator-(const StageYield& rhs) const;
+};
+
 std::string toString(SourceRange sourceRange);
 
 void copyFile(const std::string& from, const std::string& to);
@@ -0,0 +1,78 @@
+// SPDX-License-Identifier: Apache-2.0
+#include "VerdictCache.hpp"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cerrno>
+#include "Utils.hpp"
+
+void VerdictCache::open(const std::filesystem::path& file, bool reuse) {
+    fd = ::open(file.c_str(), O_RDWR | O_CREAT | O_APPEND | (reuse ? 0 : O_TRUNC), 0644);
+    if (fd < 0) {
+        PRINTF_ERR("failed to open verdict cache '%s': %s\n", file.c_str(), strerror(errno));
+        exit(1);
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) < 0) {
+        PRINTF_ERR("failed to stat verdict cache '%s': %s\n", file.c_str(), strerror(errno));
+        exit(1);
+    }
+    size_t fileSize = st.st_size;
+
+    if (fileSize >= magic.size()) {
+        auto data = static_cast<const uint8_t*>(
+            mmap(nullptr, fileSize, PROT_READ, MAP_PRIVATE, fd, 0));
+        if (data == MAP_FAILED) {
+            PRINTF_ERR("failed to map verdict cache '%s': %s\n", file.c_str(), strerror(errno));
+            exit(1);
+        }
+        if (memcmp(data, magic.data(), magic.size()) == 0) {
+            size_t records = (fileSize - magic.size()) / recordSize;
+            for (size_t i = 0; i < records; i++) {
+                const uint8_t* record = data + magic.size() + i * recordSize;
+                Sha256::Digest key;
+                memcpy(key.data(), record, key.size());
+                verdicts[key] = record[key.size()];
+            }
+            fileSize = magic.size() + records * recordSize;
+        } else {
+            PRINTF_ERR("'%s' is not a verdict cache, discarding it\n", file.c_str());
+            fileSize = 0;
+        }
+        munmap(const_cast<uint8_t*>(data), st.st_size);
+    } else {
+        fileSize = 0;
+    }
+
+    // drop garbage (unrecognized content or torn record), so appended records stay aligned
+    if (fileSize != (size_t)st.st_size && ftruncate(fd, fileSize) < 0) {
+        PRINTF_ERR("failed to truncate verdict cache '%s': %s\n", file.c_str(), strerror(errno));
+        exit(1);
+    }
+    if (fileSize == 0 && write(fd, magic.data(), magic.size()) != (ssize_t)magic.size()) {
+        PRINTF_ERR("failed to write verdict cache '%s': %s\n", file.c_str(), strerror(errno));
+        exit(1);
+    }
+}
+
+void VerdictCache::insert(const Sha256::Digest& key, bool verdict) {
+    verdicts[key] = verdict;
+    if (fd < 0) {
+        return;
+    }
+    uint8_t record[recordSize];
+    memcpy(record, key.data(), key.size());
+    record[key.size()] = verdict;
+    if (write(fd, record, recordSize) != (ssize_t)recordSize) {
+        // not fatal - we only lose the ability to reuse this verdict after restart
+        PRINTF_ERR("failed to append to verdict cache: %s\n", strerror(errno));
+    }
+}
+
+VerdictCache::~VerdictCache() {
+    if (fd >= 0) {
+        close(fd);
+    }
+}
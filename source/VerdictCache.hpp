@@ -0,0 +1,45 @@
+// SPDX-License-Identifier: Apache-2.0
+#pragma once
+#include <filesystem>
+#include <optional>
+#include <unordered_map>
+#include "Sha256.hpp"
+
+// Results of check script runs, keyed by hash of everything that was passed to the script.
+// Lets us skip running the script on inputs that were already checked (e.g. when a later pass
+// retries a removal that failed before, and nothing else has changed since then).
+//
+// Once open() is called, verdicts are also appended to a file, so they can survive restarts
+// (e.g. with sv-bugpoint-resume). The file is a magic header followed by fixed-size records
+// (digest + verdict byte); a record torn by an interrupted write is dropped on next open().
+// Verdicts already in the file are loaded only if asked to, as they go stale once the tool
+// under test changes.
+class VerdictCache {
+   public:
+    VerdictCache() : fd(-1) {}
+    ~VerdictCache();
+    VerdictCache(const VerdictCache&) = delete;
+    VerdictCache& operator=(const VerdictCache&) = delete;
+
+    // Unless reuse is set, previous content of the file is discarded
+    void open(const std::filesystem::path& file, bool reuse);
+
+    std::optional<bool> lookup(const Sha256::Digest& key) const {
+        auto it = verdicts.find(key);
+        if (it == verdicts.end()) {
+            return std::nullopt;
+        }
+        return it->second;
+    }
+
+    void insert(const Sha256::Digest& key, bool verdict);
+
+    size_t size() const { return verdicts.size(); }
+
+   private:
+    static constexpr std::string_view magic = "SVBPVC01";
+    static constexpr size_t recordSize = sizeof(Sha256::Digest) + 1;
+
+    std::unordered_map<Sha256::Digest, bool, DigestHash> verdicts;
+    int fd;
+};
@@ -7,6 +7,9 @@ grep "DOE_NOP    = 2'b00" "$@" -q && exit 0               # for caliptra_in.sv
 grep "input cin" "$@" && exit 0                           # for short_in.sv
 grep 'irremovable comment with no newline' "$@" && exit 0 # for tricky_missing_newline.sv
 grep 'irremovable comment' "$@" && exit 0                 # for disable_line_remover.sv
+grep 'module used_in_generate' "$@" && exit 0             # for unreachable.sv
+awk '/irremovable line/{n++} END{exit n != 4}' "$@" && exit 0 # for line_remover_chunks.sv
+grep -F 'initial begin begin $display("[ (keep ]", ({1' "$@" && exit 0 # for token_reducer.sv
 awk '/^`verilator_config$/{p=1} p' "$@" | grep 'irremovable verilator_config section' && exit 0
 
 exit 1
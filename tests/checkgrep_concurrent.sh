@@ -0,0 +1,11 @@
+#!/bin/bash
+# SPDX-License-Identifier: Apache-2.0
+
+# checkgrep.sh that records files it was given under index of the worker it was run by, so
+# that use of separate tmp dirs by concurrent attempts can be verified without relying on timing
+
+checks=out/concurrent_checks
+mkdir -p "$checks"
+printf "%s\n" "$@" >>"$checks/${SV_BUGPOINT_WORKER:-0}"
+
+exec ./checkgrep.sh "$@"
@@ -0,0 +1,9 @@
+#!/bin/bash
+# SPDX-License-Identifier: Apache-2.0
+
+# checkgrep.sh wrapped into check server protocol (see --check-server)
+
+while IFS=$'\t' read -r -a files; do
+  ./checkgrep.sh "${files[@]}" >/dev/null
+  echo "$?"
+done
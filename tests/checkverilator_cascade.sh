@@ -0,0 +1,10 @@
+#!/bin/bash
+# SPDX-License-Identifier: Apache-2.0
+
+# for cascade_remover.sv: uses of chained and clk are kept as long as they are declared,
+# so only cascadeRemover can remove them (along with declarations), and chained_out is kept,
+# so its assignment can't be removed along with it
+grep -q 'wire \[7:0\] chained_out' "$1" || exit 1
+grep -q 'assign chained_out' "$1" || ! grep -q 'logic \[7:0\] chained ' "$1" || exit 1
+grep -q 'always @(posedge clk)' "$1" || ! grep -q 'logic clk' "$1" || exit 1
+"$(dirname "$0")"/checkverilator_run_finish.sh "$1"
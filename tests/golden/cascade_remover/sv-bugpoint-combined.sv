@@ -0,0 +1,6 @@
+module t;
+  wire [7:0] chained_out;
+  initial begin
+    $finish;
+  end
+endmodule
@@ -0,0 +1,5 @@
+module t;
+    initial begin
+        $finish;
+    end
+endmodule
@@ -0,0 +1,4 @@
+// irremovable line 1
+// irremovable line 2
+// irremovable line 3
+// irremovable line 4
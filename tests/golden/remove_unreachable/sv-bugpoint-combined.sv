@@ -0,0 +1,2 @@
+module used_in_generate;
+endmodule
@@ -0,0 +1 @@
+module m; initial begin begin $display("[ (keep ]", ({1})); end end endmodule
@@ -0,0 +1,30 @@
+// SPDX-License-Identifier: Apache-2.0
+// typedefs used only where elaborated AST doesn't lead to their uses (in a cast and in
+// a function prototype), so they can't be removed along with them
+
+module t;
+  typedef logic [7:0] cast_t;
+  typedef logic [7:0] ret_t;
+  function automatic ret_t all_ones();
+    return 8'hff;
+  endfunction
+  // earlier stages don't remove data declarations, so this one is left for cascadeRemover
+  logic [7:0] unused = 8'h1;
+  logic [7:0] unused_copy = unused;
+  // declaration of chained_copy is a use of chained, so the assignment that uses chained_copy
+  // has to be removed along with chained too (check script keeps it as long as chained is
+  // there, and it keeps chained_out)
+  logic [7:0] chained = 8'h2;
+  logic [7:0] chained_copy = chained;
+  wire [7:0] chained_out;
+  assign chained_out = chained_copy;
+  // clk is used in event control, which can't be removed without the always block
+  // (check script keeps it as long as clk is there)
+  logic [7:0] sampled;
+  logic clk = 1'b0;
+  always @(posedge clk) sampled <= 8'h3;
+  initial begin
+    if (cast_t'(9'h1ff) == all_ones())
+      $finish;
+  end
+endmodule
@@ -0,0 +1,20 @@
+// SPDX-License-Identifier: Apache-2.0
+// lines that lineRemover has to keep, scattered among removable ones, so that
+// chunks of removable lines can't be removed at once
+// removable 1
+// irremovable line 1
+// removable 2
+// removable 3
+// removable 4
+// removable 5
+// removable 6
+// irremovable line 2
+// irremovable line 3
+// removable 7
+// removable 8
+// removable 9
+// removable 10
+// removable 11
+// removable 12
+// irremovable line 4
+// removable 13
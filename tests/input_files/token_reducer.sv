@@ -0,0 +1,2 @@
+// SPDX-License-Identifier: Apache-2.0
+module m; initial begin begin $display("[ (keep ]", ({1, (2), 3})); end end endmodule
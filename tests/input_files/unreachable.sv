@@ -0,0 +1,45 @@
+// SPDX-License-Identifier: Apache-2.0
+// declarations that can't be reached from the elaborated design, and ones that can be only by name
+
+module top;
+  if (0) begin : g
+    used_in_generate u();
+  end
+  initial $display(used_function());
+endmodule
+
+module used_in_generate;
+endmodule
+
+// not instantiated anywhere, so slang makes it a top too
+module dead_sibling;
+  dead_child u();
+endmodule
+
+module dead_child;
+endmodule
+
+// instantiated only by each other, in not taken generate branches
+module unreachable_a;
+  if (0) begin : g
+    unreachable_b u();
+  end
+endmodule
+
+module unreachable_b;
+  if (0) begin : g
+    unreachable_a u();
+  end
+endmodule
+
+package unused_pkg;
+  localparam int P = 1;
+endpackage
+
+function automatic int used_function();
+  return 1;
+endfunction
+
+function automatic int unused_function();
+  return unused_pkg::P;
+endfunction